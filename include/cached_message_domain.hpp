@@ -0,0 +1,304 @@
+/* A domain adapter which memoises the messages of another domain
+(C) 2026 agent <agent@local> (3 commits)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef SYSTEM_ERROR2_CACHED_MESSAGE_DOMAIN_HPP
+#define SYSTEM_ERROR2_CACHED_MESSAGE_DOMAIN_HPP
+
+#include "generic_code.hpp"
+
+#ifndef SYSTEM_ERROR2_CACHED_MESSAGE_STATISTICS_SHARDS
+//! The number of shards of the statistics of each message cache. Threads are spread across these, so readers do not contend.
+#define SYSTEM_ERROR2_CACHED_MESSAGE_STATISTICS_SHARDS 16
+#endif
+
+SYSTEM_ERROR2_NAMESPACE_BEGIN
+
+//! A snapshot of the statistics of the message cache of a `cached_message_domain`.
+struct cached_message_statistics
+{
+  //! The number of messages found in the cache.
+  unsigned long long hits{0};
+  //! The number of messages not found in the cache, and so fetched from the wrapped domain.
+  unsigned long long misses{0};
+  //! The number of cached messages replaced by the message of a different value.
+  unsigned long long evictions{0};
+  //! The number of messages fetched which were too long to cache.
+  unsigned long long uncacheable{0};
+
+  //! The fraction of lookups which hit, or zero if there have been none.
+  double hit_ratio() const noexcept { return (hits + misses == 0) ? 0.0 : static_cast<double>(hits) / static_cast<double>(hits + misses); }
+};
+
+namespace detail
+{
+  // Two cache lines. The key, length and text are only valid if seq is even and unchanged after reading them.
+  struct alignas(64) cached_message_slot
+  {
+    static constexpr size_t max_length = 112;
+
+    std::atomic<unsigned long long> key;
+    std::atomic<unsigned> seq;     // odd whilst being written
+    std::atomic<unsigned> length;  // zero if unused, else one plus the length of the message
+    std::atomic<unsigned long long> text[max_length / 8];
+  };
+  struct alignas(64) cached_message_statistics_shard
+  {
+    std::atomic<unsigned long long> hits, misses, evictions, uncacheable;
+  };
+  // A template so each cache is zero initialised without a guard, leaving the domain itself constexpr
+  template <class Domain, size_t Slots> struct cached_message_table
+  {
+    static cached_message_slot slots[Slots];
+    static cached_message_statistics_shard statistics[SYSTEM_ERROR2_CACHED_MESSAGE_STATISTICS_SHARDS];
+  };
+  template <class Domain, size_t Slots> cached_message_slot cached_message_table<Domain, Slots>::slots[Slots];
+  template <class Domain, size_t Slots> cached_message_statistics_shard cached_message_table<Domain, Slots>::statistics[SYSTEM_ERROR2_CACHED_MESSAGE_STATISTICS_SHARDS];
+}  // namespace detail
+
+/*! A domain identical to `Base`, except that the messages of its codes are memoised by value in a bounded
+cache of `Slots` messages, each at most 112 characters long. Use it where `Base::_do_message()` is expensive,
+for example where it formats or looks up its message afresh on every call:
+
+\code
+using cached_code = status_code<cached_message_domain<my_domain>>;
+\endcode
+
+Codes of this domain have the same id as those of `Base`, and so are equivalent to them. For the same reason
+this domain must never be registered with `register_domain()`, which refuses it, else lookups by id could
+return either domain. Codes of this domain decoded, or made portable, come back as codes of `Base`. `Base` must have a
+static `get()`, and its value type must be an integer or enum. Its `final` overrides are not a problem, as
+this forwards to `Base::get()` rather than deriving from `Base`.
+
+The cache is a set associative table of four way sets, each slot guarded by a sequence lock. Readers take no
+lock and write to no shared memory; they copy a hit into a fresh reference counted `string_ref`, or into the
+caller's buffer in `format_message_to()` without allocating. Misses call `Base::_do_message()` then try to
+cache the result, which is abandoned if another thread is writing the chosen slot. Hits, misses, evictions and
+messages too long to cache are counted in per thread shards, and summed by `statistics()`.
+*/
+template <class Base, size_t Slots = 64> class cached_message_domain : public status_code_domain
+{
+  static_assert(Slots >= 4 && (Slots & (Slots - 1)) == 0, "Slots must be a power of two of at least four");
+  template <class DomainType> friend class status_code;
+  using _base = status_code_domain;
+  using _table = detail::cached_message_table<cached_message_domain, Slots>;
+  using _slot = detail::cached_message_slot;
+  static constexpr size_t _ways = 4;
+
+public:
+  //! The value type, which is that of `Base`.
+  using value_type = typename Base::value_type;
+  using _base::string_ref;
+  static_assert(std::is_integral<value_type>::value || std::is_enum<value_type>::value, "Only domains with integer or enum values can have their messages cached");
+  static_assert(sizeof(value_type) <= sizeof(unsigned long long), "Only domains whose values fit into an unsigned long long can have their messages cached");
+
+  //! Default constructor, taking the id of `Base`.
+  constexpr cached_message_domain() noexcept
+      : _base(Base::get().id(), Base::get().equivalence_is_value_equality())
+  {
+  }
+  cached_message_domain(const cached_message_domain &) = default;
+  cached_message_domain(cached_message_domain &&) = default;  // NOLINT
+  cached_message_domain &operator=(const cached_message_domain &) = default;
+  cached_message_domain &operator=(cached_message_domain &&) = default;  // NOLINT
+  ~cached_message_domain() = default;
+
+#if __cplusplus < 201402L && !defined(_MSC_VER)
+  static inline const cached_message_domain &get()
+  {
+    static cached_message_domain v;
+    return v;
+  }
+#else
+  //! Constexpr singleton getter.
+  static inline constexpr const cached_message_domain &get();
+#endif
+
+  //! Sums the statistics of the message cache, which are approximate whilst other threads use it.
+  static cached_message_statistics statistics() noexcept
+  {
+    cached_message_statistics ret;
+    for(const auto &shard : _table::statistics)
+    {
+      ret.hits += shard.hits.load(std::memory_order_relaxed);
+      ret.misses += shard.misses.load(std::memory_order_relaxed);
+      ret.evictions += shard.evictions.load(std::memory_order_relaxed);
+      ret.uncacheable += shard.uncacheable.load(std::memory_order_relaxed);
+    }
+    return ret;
+  }
+
+  virtual string_ref name() const noexcept override { return Base::get().name(); }  // NOLINT
+
+private:
+  static const _base &_wrapped() noexcept { return Base::get(); }
+  static unsigned long long _key(const status_code<void> &code) noexcept { return static_cast<unsigned long long>(static_cast<const status_code<cached_message_domain> &>(code).value()); }  // NOLINT
+  static size_t _set(unsigned long long key) noexcept
+  {
+    const unsigned long long h = key * 0x9e3779b97f4a7c15ULL;
+    return static_cast<size_t>(h >> 40U) & (Slots / _ways - 1);
+  }
+  static detail::cached_message_statistics_shard &_statistics() noexcept
+  {
+    // Thread local storage is usually similarly aligned in each thread, so mix all the bits of the address
+    const auto tag = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(detail::this_thread_tag()));  // NOLINT
+    return _table::statistics[static_cast<size_t>((tag * 0x9e3779b97f4a7c15ULL) >> 32U) % SYSTEM_ERROR2_CACHED_MESSAGE_STATISTICS_SHARDS];
+  }
+
+  // Copies the cached message for key into buffer, returning one plus its length, or zero on a miss
+  static size_t _lookup(unsigned long long key, char (&buffer)[_slot::max_length]) noexcept
+  {
+    _slot *set = _table::slots + _set(key) * _ways;
+    for(size_t way = 0; way < _ways; way++)
+    {
+      _slot &slot = set[way];
+      const unsigned seq = slot.seq.load(std::memory_order_acquire);
+      if((seq & 1) != 0 || slot.key.load(std::memory_order_relaxed) != key)
+      {
+        continue;
+      }
+      const unsigned length = slot.length.load(std::memory_order_relaxed);
+      if(length == 0)
+      {
+        continue;
+      }
+      unsigned long long words[_slot::max_length / 8];
+      for(size_t n = 0; n < (length + 6) / 8; n++)
+      {
+        words[n] = slot.text[n].load(std::memory_order_relaxed);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if(slot.seq.load(std::memory_order_relaxed) == seq)
+      {
+        memcpy(buffer, words, length - 1);  // NOLINT
+        return length;
+      }
+    }
+    return 0;
+  }
+  static void _insert(unsigned long long key, const char *str, size_t length) noexcept
+  {
+    auto &statistics = _statistics();
+    if(length > _slot::max_length)
+    {
+      statistics.uncacheable.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    // Prefer a slot already holding this key, then an unused one, then evict one chosen by the key
+    _slot *set = _table::slots + _set(key) * _ways;
+    _slot *victim = nullptr;
+    for(size_t way = 0; way < _ways && victim == nullptr; way++)
+    {
+      if(set[way].length.load(std::memory_order_relaxed) != 0 && set[way].key.load(std::memory_order_relaxed) == key)
+      {
+        victim = &set[way];
+      }
+    }
+    for(size_t way = 0; way < _ways && victim == nullptr; way++)
+    {
+      if(set[way].length.load(std::memory_order_relaxed) == 0)
+      {
+        victim = &set[way];
+      }
+    }
+    if(victim == nullptr)
+    {
+      victim = &set[(key ^ (key >> 7U) ^ statistics.misses.load(std::memory_order_relaxed)) % _ways];
+    }
+    unsigned seq = victim->seq.load(std::memory_order_relaxed);
+    if((seq & 1) != 0 || !victim->seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed))
+    {
+      return;  // another thread is writing this slot, so leave it be
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    if(victim->length.load(std::memory_order_relaxed) != 0 && victim->key.load(std::memory_order_relaxed) != key)
+    {
+      statistics.evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    unsigned long long words[_slot::max_length / 8]{};
+    if(length > 0)
+    {
+      memcpy(words, str, length);  // NOLINT
+    }
+    for(size_t n = 0; n < (length + 7) / 8; n++)
+    {
+      victim->text[n].store(words[n], std::memory_order_relaxed);
+    }
+    victim->key.store(key, std::memory_order_relaxed);
+    victim->length.store(static_cast<unsigned>(length + 1), std::memory_order_relaxed);
+    victim->seq.store(seq + 2, std::memory_order_release);
+  }
+
+protected:
+  virtual bool _do_failure(const status_code<void> &code) const noexcept override { return _wrapped()._do_failure(code); }  // NOLINT
+  virtual bool _do_equivalent(const status_code<void> &code1, const status_code<void> &code2) const noexcept override { return _wrapped()._do_equivalent(code1, code2); }  // NOLINT
+  virtual generic_code _generic_code(const status_code<void> &code) const noexcept override { return _wrapped()._generic_code(code); }  // NOLINT
+  virtual string_ref _do_message(const status_code<void> &code) const noexcept override  // NOLINT
+  {
+    assert(code.domain() == *this);
+    const unsigned long long key = _key(code);
+    char buffer[_slot::max_length];
+    const size_t length = _lookup(key, buffer);
+    if(length != 0)
+    {
+      _statistics().hits.fetch_add(1, std::memory_order_relaxed);
+      return _base::atomic_refcounted_block_string_ref(buffer, length - 1);
+    }
+    _statistics().misses.fetch_add(1, std::memory_order_relaxed);
+    string_ref ret = _wrapped()._do_message(code);
+    _insert(key, ret.data(), ret.size());
+    return ret;
+  }
+  virtual size_t _do_format_message(const status_code<void> &code, char *buffer, size_t bytes) const noexcept override  // NOLINT
+  {
+    assert(code.domain() == *this);
+    char temp[_slot::max_length];
+    const size_t length = _lookup(_key(code), temp);
+    if(length == 0)
+    {
+      // Filling the cache needs message(), which may allocate, so leave that to it
+      _statistics().misses.fetch_add(1, std::memory_order_relaxed);
+      return _wrapped()._do_format_message(code, buffer, bytes);
+    }
+    _statistics().hits.fetch_add(1, std::memory_order_relaxed);
+    detail::message_writer w(buffer, bytes);
+    w.append(temp, length - 1);
+    return w.finish();
+  }
+  virtual message_view_type _do_message_view(const status_code<void> &code) const noexcept override { return _wrapped()._do_message_view(code); }  // NOLINT
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(STANDARDESE_IS_IN_THE_HOUSE)
+  SYSTEM_ERROR2_NORETURN virtual void _do_throw_exception(const status_code<void> &code) const override  // NOLINT
+  {
+    _wrapped()._do_throw_exception(code);
+    abort();  // suppress buggy GCC warning
+  }
+#endif
+};
+#if __cplusplus >= 201402L || defined(_MSC_VER)
+template <class Base, size_t Slots> constexpr cached_message_domain<Base, Slots> _cached_message_domain{};
+template <class Base, size_t Slots> inline constexpr const cached_message_domain<Base, Slots> &cached_message_domain<Base, Slots>::get() { return _cached_message_domain<Base, Slots>; }
+#endif
+
+SYSTEM_ERROR2_NAMESPACE_END
+
+#endif
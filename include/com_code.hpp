@@ -55,7 +55,7 @@ using com_error = status_error<_com_code_domain>;
 class _com_code_domain : public status_code_domain
 {
   template <class DomainType> friend class status_code;
-  template <class StatusCode> friend class detail::indirecting_domain;
+  template <class StatusCode, class Allocator> friend class detail::indirecting_domain;
   using _base = status_code_domain;
 
   //! Construct from a `HRESULT` error code
@@ -130,13 +130,15 @@ public:
 
   //! Constexpr singleton getter. Returns the constexpr com_code_domain variable.
   static inline constexpr const _com_code_domain &get();
+  //! True if a code of this domain with value `v` is a failure, without need of a virtual function call.
+  static constexpr bool _failure_of(const value_type &v) noexcept { return v < 0; }
 
   virtual string_ref name() const noexcept override { return string_ref("COM domain"); }  // NOLINT
 protected:
   virtual bool _do_failure(const status_code<void> &code) const noexcept override  // NOLINT
   {
     assert(code.domain() == *this);
-    return static_cast<const com_code &>(code).value() < 0;  // NOLINT
+    return _failure_of(static_cast<const com_code &>(code).value());  // NOLINT
   }
   /*! Note semantic equivalence testing is only implemented for `FACILITY_WIN32` and `FACILITY_NT_BIT`.
   */
@@ -224,6 +226,7 @@ protected:
 };
 //! (Windows only) A constexpr source variable for the COM code domain. Returned by `_com_code_domain::get()`.
 constexpr _com_code_domain com_code_domain;
+SYSTEM_ERROR2_REGISTER_DOMAIN(com_code_domain);
 inline constexpr const _com_code_domain &_com_code_domain::get()
 {
   return com_code_domain;
@@ -44,6 +44,83 @@ http://www.boost.org/LICENSE_1_0.txt)
 // 0.01
 #include <initializer_list>
 
+#ifndef SYSTEM_ERROR2_HAVE_TIMESTAMP_COUNTER
+#if((defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__) || defined(__aarch64__))) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+//! Defined to 1 if `detail::read_timestamp_counter()` reads a hardware cycle or time counter. Usually automatic, can be overriden.
+#define SYSTEM_ERROR2_HAVE_TIMESTAMP_COUNTER 1
+#else
+#define SYSTEM_ERROR2_HAVE_TIMESTAMP_COUNTER 0
+#endif
+#endif
+#if SYSTEM_ERROR2_HAVE_TIMESTAMP_COUNTER && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>  // for __rdtsc
+#endif
+
+/* Static tracepoints, which a tracer such as bpftrace, perf or SystemTap can attach to
+in a running process. Defining SYSTEM_ERROR2_USDT to 1 enables them. Each probe is a single
+nop plus an ELF note describing where its two arguments are, and the arguments are usually
+already in registers. If <sys/sdt.h> is unavailable, the same notes are emitted directly
+on ELF x64 and AArch64 with GCC or clang. Elsewhere the probes compile to nothing.
+*/
+#ifndef SYSTEM_ERROR2_USDT_PROBE
+#if defined(SYSTEM_ERROR2_USDT) && SYSTEM_ERROR2_USDT
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SYSTEM_ERROR2_USDT_PROBE(name, id, value) DTRACE_PROBE2(system_error2, name, static_cast<unsigned long long>(id), static_cast<long long>(value))
+#endif
+#endif
+#if !defined(SYSTEM_ERROR2_USDT_PROBE) && (defined(__GNUC__) || defined(__clang__)) && defined(__ELF__) && (defined(__x86_64__) || defined(__aarch64__))
+// Equivalent to what <sys/sdt.h> emits for a probe with two 64 bit arguments
+#define SYSTEM_ERROR2_USDT_PROBE(name, id, value)                                                                                                              \
+  __asm__ __volatile__("990: nop\n"                                                                                                                             \
+                       ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                                                                          \
+                       ".balign 4\n"                                                                                                                           \
+                       ".4byte 992f-991f, 994f-993f, 3\n"                                                                                                      \
+                       "991: .asciz \"stapsdt\"\n"                                                                                                            \
+                       "992: .balign 4\n"                                                                                                                      \
+                       "993: .8byte 990b\n"                                                                                                                    \
+                       ".8byte _.stapsdt.base\n"                                                                                                               \
+                       ".8byte 0\n"                                                                                                                            \
+                       ".asciz \"system_error2\"\n"                                                                                                           \
+                       ".asciz \"" #name "\"\n"                                                                                                               \
+                       ".asciz \"8@%[_id] -8@%[_value]\"\n"                                                                                                   \
+                       "994: .balign 4\n"                                                                                                                      \
+                       ".popsection\n"                                                                                                                         \
+                       ".ifndef _.stapsdt.base\n"                                                                                                              \
+                       ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"                                                                 \
+                       ".weak _.stapsdt.base\n"                                                                                                                \
+                       ".hidden _.stapsdt.base\n"                                                                                                              \
+                       "_.stapsdt.base: .space 1\n"                                                                                                            \
+                       ".size _.stapsdt.base, 1\n"                                                                                                             \
+                       ".popsection\n"                                                                                                                         \
+                       ".endif\n"                                                                                                                              \
+                       :                                                                                                                                       \
+                       : [_id] "nor"(static_cast<unsigned long long>(id)), [_value] "nor"(static_cast<long long>(value)))
+#endif
+#endif
+#ifndef SYSTEM_ERROR2_USDT_PROBE
+//! Fires the static tracepoint `system_error2:name` with the arguments `id` and `value`, if SYSTEM_ERROR2_USDT is enabled. Can be overriden.
+#define SYSTEM_ERROR2_USDT_PROBE(name, id, value) ((void) 0)
+#else
+#define SYSTEM_ERROR2_USDT_ENABLED 1
+#endif
+#endif
+#ifndef SYSTEM_ERROR2_HAVE_IS_CONSTANT_EVALUATED
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+//! Defined to 1 if `__builtin_is_constant_evaluated()` is available. Usually automatic, can be overriden.
+#define SYSTEM_ERROR2_HAVE_IS_CONSTANT_EVALUATED 1
+#endif
+#elif(defined(__GNUC__) && __GNUC__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1925)
+#define SYSTEM_ERROR2_HAVE_IS_CONSTANT_EVALUATED 1
+#endif
+#endif
+// Probes in constexpr constructors must be skipped during constant evaluation
+#if defined(SYSTEM_ERROR2_USDT_ENABLED) && !defined(SYSTEM_ERROR2_USDT_CONSTEXPR_PROBES) && (__cplusplus >= 201402L) && defined(SYSTEM_ERROR2_HAVE_IS_CONSTANT_EVALUATED)
+#define SYSTEM_ERROR2_USDT_CONSTEXPR_PROBES 1
+#endif
+
 #ifndef SYSTEM_ERROR2_CONSTEXPR14
 #if defined(STANDARDESE_IS_IN_THE_HOUSE) || __cplusplus >= 201400 || _MSC_VER >= 1910 /* VS2017 */
 //! Defined to be `constexpr` when on C++ 14 or better compilers. Usually automatic, can be overriden.
@@ -53,6 +130,15 @@ http://www.boost.org/LICENSE_1_0.txt)
 #endif
 #endif
 
+#ifndef SYSTEM_ERROR2_CONSTEXPR20
+#if defined(STANDARDESE_IS_IN_THE_HOUSE) || (defined(__cpp_constexpr) && __cpp_constexpr >= 201907L)
+//! Defined to be `constexpr` when on compilers supporting constexpr destructors. Usually automatic, can be overriden.
+#define SYSTEM_ERROR2_CONSTEXPR20 constexpr
+#else
+#define SYSTEM_ERROR2_CONSTEXPR20
+#endif
+#endif
+
 #ifndef SYSTEM_ERROR2_NORETURN
 #if defined(STANDARDESE_IS_IN_THE_HOUSE) || (_HAS_CXX17 && _MSC_VER >= 1911 /* VS2017.3 */)
 #define SYSTEM_ERROR2_NORETURN [[noreturn]]
@@ -157,6 +243,22 @@ namespace detail
     return end - str;
   }
 
+  //! Reads the time stamp counter on x86, the virtual counter on AArch64, or returns zero if `SYSTEM_ERROR2_HAVE_TIMESTAMP_COUNTER` is zero.
+  inline unsigned long long read_timestamp_counter() noexcept
+  {
+#if !SYSTEM_ERROR2_HAVE_TIMESTAMP_COUNTER
+    return 0;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    unsigned long long v;
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return __builtin_ia32_rdtsc();
+#endif
+  }
+
   /* A partially compliant implementation of C++20's std::bit_cast function contributed
   by Jesse Towner. TODO FIXME Replace with C++ 20 bit_cast when available.
 
@@ -257,27 +359,31 @@ namespace detail
     }
   };
 
-  template <class To, class From, typename std::enable_if<is_erasure_castable<To, From>::value && (sizeof(To) == sizeof(From)), bool>::type = true> constexpr To erasure_cast(const From &from) noexcept { return bit_cast<To>(from); }
+  template <class To, class From, typename std::enable_if<is_erasure_castable<To, From>::value && (sizeof(To) == sizeof(From)), bool>::type = true> constexpr To erasure_cast(const From &from) noexcept { return detail::bit_cast<To>(from); }
 
-  template <class To, class From, typename std::enable_if<is_erasure_castable<To, From>::value && is_static_castable<To, From>::value && (sizeof(To) < sizeof(From)), bool>::type = true> constexpr To erasure_cast(const From &from) noexcept { return static_cast<To>(bit_cast<erasure_integer_type<From, To>>(from)); }
+  template <class To, class From, typename std::enable_if<is_erasure_castable<To, From>::value && is_static_castable<To, From>::value && (sizeof(To) < sizeof(From)), bool>::type = true> constexpr To erasure_cast(const From &from) noexcept { return static_cast<To>(detail::bit_cast<erasure_integer_type<From, To>>(from)); }
 
-  template <class To, class From, typename std::enable_if<is_erasure_castable<To, From>::value && is_static_castable<To, From>::value && (sizeof(To) > sizeof(From)), bool>::type = true> constexpr To erasure_cast(const From &from) noexcept { return bit_cast<To>(static_cast<erasure_integer_type<To, From>>(from)); }
+  template <class To, class From, typename std::enable_if<is_erasure_castable<To, From>::value && is_static_castable<To, From>::value && (sizeof(To) > sizeof(From)), bool>::type = true> constexpr To erasure_cast(const From &from) noexcept { return detail::bit_cast<To>(static_cast<erasure_integer_type<To, From>>(from)); }
 
   template <class To, class From, typename std::enable_if<is_erasure_castable<To, From>::value && !is_static_castable<To, From>::value && (sizeof(To) < sizeof(From)), bool>::type = true> constexpr To erasure_cast(const From &from) noexcept
   {
-    return bit_cast<padded_erasure_object<To, sizeof(From) - sizeof(To)>>(from).value;
+    return detail::bit_cast<padded_erasure_object<To, sizeof(From) - sizeof(To)>>(from).value;
   }
 
   template <class To, class From, typename std::enable_if<is_erasure_castable<To, From>::value && !is_static_castable<To, From>::value && (sizeof(To) > sizeof(From)), bool>::type = true> constexpr To erasure_cast(const From &from) noexcept
   {
-    return bit_cast<To>(padded_erasure_object<From, sizeof(To) - sizeof(From)>{from});
+    return detail::bit_cast<To>(padded_erasure_object<From, sizeof(To) - sizeof(From)>{from});
   }
 }  // namespace detail
 SYSTEM_ERROR2_NAMESPACE_END
 
-#ifndef SYSTEM_ERROR2_FATAL
+#if !defined(SYSTEM_ERROR2_FATAL) || defined(SYSTEM_ERROR2_FLIGHT_RECORDER)
 #ifdef SYSTEM_ERROR2_NOT_POSIX
+#ifndef SYSTEM_ERROR2_FATAL
 #error If SYSTEM_ERROR2_NOT_POSIX is defined, you must define your own SYSTEM_ERROR2_FATAL implementation!
+#else
+#error The flight recorder writes via write(), so it cannot be used if SYSTEM_ERROR2_NOT_POSIX is defined!
+#endif
 #endif
 #include <cstdlib>  // for abort
 #ifdef __APPLE__
@@ -300,11 +406,26 @@ namespace detail
 #endif
 #endif
   }  // namespace avoid_stdio_include
+}  // namespace detail
+SYSTEM_ERROR2_NAMESPACE_END
+#endif
+
+#ifdef SYSTEM_ERROR2_FLIGHT_RECORDER
+#include "flight_recorder.hpp"
+#endif
+
+#ifndef SYSTEM_ERROR2_FATAL
+SYSTEM_ERROR2_NAMESPACE_BEGIN
+namespace detail
+{
   inline void do_fatal_exit(const char *msg)
   {
     using namespace avoid_stdio_include;
     write(2 /*stderr*/, msg, cstrlen(msg));
     write(2 /*stderr*/, "\n", 1);
+#ifdef SYSTEM_ERROR2_FLIGHT_RECORDER
+    flight_recorder_dump(2 /*stderr*/);
+#endif
     abort();
   }
 }  // namespace detail
@@ -0,0 +1,294 @@
+/* Registry mapping domain unique ids back to domains
+(C) 2026 agent <agent@local> (5 commits)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef SYSTEM_ERROR2_DOMAIN_REGISTRY_HPP
+#define SYSTEM_ERROR2_DOMAIN_REGISTRY_HPP
+
+#include "status_code_domain.hpp"
+
+#ifndef SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS
+//! The number of domains the registry can hold. Must be a power of two. Kept at most half full, most lookups are a single probe.
+#define SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS 512
+#endif
+
+#ifndef SYSTEM_ERROR2_DOMAIN_REGISTRY_SECTION
+/*! The name of the linker section in which `SYSTEM_ERROR2_REGISTER_DOMAIN` places domains on ELF platforms.
+Must be a valid C identifier. Override if the library is included twice in one program in different namespaces.
+*/
+#define SYSTEM_ERROR2_DOMAIN_REGISTRY_SECTION system_error2_domains
+#endif
+
+#ifndef SYSTEM_ERROR2_HAVE_DOMAIN_REGISTRY_SECTION
+#if defined(__ELF__) && (defined(__GNUC__) || defined(__clang__))
+//! True if `SYSTEM_ERROR2_REGISTER_DOMAIN` registers domains at constant initialisation time via a linker section
+#define SYSTEM_ERROR2_HAVE_DOMAIN_REGISTRY_SECTION 1
+#else
+#define SYSTEM_ERROR2_HAVE_DOMAIN_REGISTRY_SECTION 0
+#endif
+#endif
+
+#define SYSTEM_ERROR2_DOMAIN_REGISTRY_STRINGIZE2(x) #x
+#define SYSTEM_ERROR2_DOMAIN_REGISTRY_STRINGIZE(x) SYSTEM_ERROR2_DOMAIN_REGISTRY_STRINGIZE2(x)
+
+#if SYSTEM_ERROR2_HAVE_DOMAIN_REGISTRY_SECTION
+#if defined(__has_attribute)
+#if __has_attribute(retain)
+#define SYSTEM_ERROR2_DOMAIN_REGISTRY_RETAIN , retain
+#endif
+#endif
+#ifndef SYSTEM_ERROR2_DOMAIN_REGISTRY_RETAIN
+#define SYSTEM_ERROR2_DOMAIN_REGISTRY_RETAIN
+#endif
+/*! Registers `domain`, a constexpr variable of a type derived from `status_code_domain`, with the domain
+registry. On ELF platforms this places its address in a linker section, so costs nothing at startup;
+elsewhere it registers during static initialisation. Use at namespace scope. Refuses to compile for a
+`cached_message_domain`, which must never be registered.
+*/
+#define SYSTEM_ERROR2_REGISTER_DOMAIN(domain)                                                                                                                                                                                                                                                                                  \
+  static_assert(!SYSTEM_ERROR2_NAMESPACE::detail::is_cached_message_domain<typename std::decay<decltype(domain)>::type>::value, "a cached_message_domain shares the id of the domain it wraps, so register that instead"); \
+  __attribute__((used SYSTEM_ERROR2_DOMAIN_REGISTRY_RETAIN, section(SYSTEM_ERROR2_DOMAIN_REGISTRY_STRINGIZE(SYSTEM_ERROR2_DOMAIN_REGISTRY_SECTION)))) static const SYSTEM_ERROR2_NAMESPACE::detail::domain_registration domain##_registration = {&(domain), SYSTEM_ERROR2_NAMESPACE::detail::domain_value_is_integral<typename std::decay<decltype(domain)>::type>::value}
+#else
+#define SYSTEM_ERROR2_REGISTER_DOMAIN(domain) static const bool domain##_registration = SYSTEM_ERROR2_NAMESPACE::register_domain(domain)
+#endif
+
+#if SYSTEM_ERROR2_HAVE_DOMAIN_REGISTRY_SECTION
+// The linker defines these for each executable and shared object with the section. Hidden, so each refers to its own.
+extern "C" const char system_error2_domain_registry_begin[] __asm__("__start_" SYSTEM_ERROR2_DOMAIN_REGISTRY_STRINGIZE(SYSTEM_ERROR2_DOMAIN_REGISTRY_SECTION)) __attribute__((weak, visibility("hidden")));
+extern "C" const char system_error2_domain_registry_end[] __asm__("__stop_" SYSTEM_ERROR2_DOMAIN_REGISTRY_STRINGIZE(SYSTEM_ERROR2_DOMAIN_REGISTRY_SECTION)) __attribute__((weak, visibility("hidden")));
+#endif
+
+SYSTEM_ERROR2_NAMESPACE_BEGIN
+
+namespace detail
+{
+  static_assert((SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS & (SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS - 1)) == 0, "SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS must be a power of two");
+
+  struct domain_registry_slot
+  {
+    std::atomic<unsigned long long> id;  // zero if unused, set once by whoever claims the slot
+    std::atomic<const status_code_domain *> domain;  // null until published
+    std::atomic<bool> integral;  // written before domain is published
+  };
+  // An entry of the linker section
+  struct domain_registration
+  {
+    const status_code_domain *domain;
+    bool integral;
+  };
+  /* True if the value of codes of `Domain` is an integer or enum fitting into an `intptr_t`, so a code
+  can be rebuilt from a domain id and a value received from elsewhere. False for domains whose values
+  are pointers, which must never be rebuilt from untrusted input, and for `status_code_domain` itself.
+  */
+  template <class Domain, class = void> struct domain_value_is_integral : std::false_type
+  {
+  };
+  template <class Domain>
+  struct domain_value_is_integral<Domain, typename std::enable_if<std::is_integral<typename Domain::value_type>::value || std::is_enum<typename Domain::value_type>::value>::type>
+      : std::integral_constant<bool, sizeof(typename Domain::value_type) <= sizeof(intptr_t)>
+  {
+  };
+  // Adapters sharing the id of another domain, which only that domain may register under
+  template <class T> struct is_cached_message_domain : std::false_type
+  {
+  };
+  template <class Base, size_t Slots> struct is_cached_message_domain<cached_message_domain<Base, Slots>> : std::true_type
+  {
+  };
+
+  // A template so the table is zero initialised without a guard. Other tags make other tables.
+  template <class = void> struct domain_registry_table
+  {
+    static domain_registry_slot slots[SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS];
+    static std::atomic<size_t> used;
+  };
+  template <class T> domain_registry_slot domain_registry_table<T>::slots[SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS];
+  template <class T> std::atomic<size_t> domain_registry_table<T>::used;
+
+  // Ids are meant to be random, but mix them anyway in case some are not
+  inline size_t domain_registry_index(unsigned long long id) noexcept { return static_cast<size_t>((id * 0x9e3779b97f4a7c15ULL) >> 32U) & (SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS - 1); }
+
+  template <class Tag = void> inline const status_code_domain *domain_registry_find(unsigned long long id, bool *integral = nullptr) noexcept
+  {
+    using table = domain_registry_table<Tag>;
+    size_t idx = domain_registry_index(id);
+    for(size_t n = 0; n < SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS; n++, idx = (idx + 1) & (SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS - 1))
+    {
+      auto &slot = table::slots[idx];
+      const unsigned long long key = slot.id.load(std::memory_order_acquire);
+      if(key == 0)
+      {
+        return nullptr;
+      }
+      if(key == id)
+      {
+        // May be null if being registered concurrently
+        const status_code_domain *ret = slot.domain.load(std::memory_order_acquire);
+        if(integral != nullptr)
+        {
+          *integral = ret != nullptr && slot.integral.load(std::memory_order_relaxed);
+        }
+        return ret;
+      }
+    }
+    return nullptr;
+  }
+
+  template <class Tag = void> inline bool domain_registry_insert(const status_code_domain &domain, bool integral = false) noexcept
+  {
+    using table = domain_registry_table<Tag>;
+    const unsigned long long id = domain.id();
+    if(id == 0)
+    {
+      return false;
+    }
+    if(table::used.load(std::memory_order_relaxed) >= SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS / 2)
+    {
+      return domain_registry_find<Tag>(id) != nullptr;
+    }
+    size_t idx = domain_registry_index(id);
+    for(size_t n = 0; n < SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS; n++, idx = (idx + 1) & (SYSTEM_ERROR2_DOMAIN_REGISTRY_SLOTS - 1))
+    {
+      auto &slot = table::slots[idx];
+      unsigned long long key = slot.id.load(std::memory_order_acquire);
+      if(key == 0 && slot.id.compare_exchange_strong(key, id, std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+        slot.integral.store(integral, std::memory_order_relaxed);
+        slot.domain.store(&domain, std::memory_order_release);
+        table::used.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+      // Either the slot was already claimed, or we lost the race for it, so key is its id
+      if(key == id)
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+#if SYSTEM_ERROR2_HAVE_DOMAIN_REGISTRY_SECTION
+  // Whether the section of the executable or shared object containing the caller has been imported
+  template <class = void> struct domain_registry_module
+  {
+    __attribute__((visibility("hidden"))) static std::atomic<bool> imported;
+  };
+  template <class T> std::atomic<bool> domain_registry_module<T>::imported;
+#endif
+}  // namespace detail
+
+/*! Registers `domain`, so `find_domain()` can find it by its id. Returns true if a domain with its id
+is now registered, which may be another instance, as domains with equal ids are the same domain. Returns
+false if its id is zero, or if the registry is full.
+
+Lock free and append only, so may be called at any time from any thread, including by plugins loaded
+at runtime, whose domains must outlive any use of the registry. Domains can never be unregistered.
+
+Codes of the domain can only be rebuilt from a domain id and a value, as by `decode_status_code()` and
+`portable_code`, if it is registered as its own type and its value type is an integer or enum. Domains
+registered through a reference to `status_code_domain` are found, but their codes are never rebuilt.
+*/
+inline bool register_domain(const status_code_domain &domain) noexcept
+{
+  return detail::domain_registry_insert<>(domain);
+}
+//! \overload
+template <class Domain, typename std::enable_if<std::is_base_of<status_code_domain, Domain>::value, bool>::type = true> inline bool register_domain(const Domain &domain) noexcept
+{
+  return detail::domain_registry_insert<>(domain, detail::domain_value_is_integral<Domain>::value);
+}
+/*! A `cached_message_domain` has the id of the domain it wraps, so if registered, `find_domain()`, and
+thus decoding and `portable_code`, could return either of them. Register the wrapped domain instead.
+*/
+template <class Base, size_t Slots> bool register_domain(const cached_message_domain<Base, Slots> &domain) noexcept = delete;
+
+/*! Registers every domain declared with `SYSTEM_ERROR2_REGISTER_DOMAIN` in the executable or shared
+object from which this is called, returning how many were newly registered or already registered.
+`find_domain()` does this for its own executable or shared object on first miss, so this need only be
+called by plugins loaded at runtime, for example from a static initialiser, so their domains are found
+by lookups made elsewhere. Does nothing where domains are not registered via a linker section.
+
+As with any variable defined in a header, the executable and plugins share one registry only if the
+executable exports it to them, for example by being linked with `-rdynamic`.
+*/
+inline size_t register_module_domains() noexcept
+{
+  size_t ret = 0;
+#if SYSTEM_ERROR2_HAVE_DOMAIN_REGISTRY_SECTION
+  if(system_error2_domain_registry_begin != nullptr)
+  {
+    const auto *begin = reinterpret_cast<const detail::domain_registration *>(system_error2_domain_registry_begin);  // NOLINT
+    const auto *end = reinterpret_cast<const detail::domain_registration *>(system_error2_domain_registry_end);      // NOLINT
+    for(; begin != end; ++begin)
+    {
+      if(detail::domain_registry_insert<>(*begin->domain, begin->integral))
+      {
+        ++ret;
+      }
+    }
+  }
+  detail::domain_registry_module<>::imported.store(true, std::memory_order_release);
+#endif
+  return ret;
+}
+
+/*! Returns the registered domain with unique id `id`, or null if none is. Lock free, and usually a single
+probe of a hash table. All domains supplied by this library are registered automatically, including the
+indirecting domains once a code of theirs has been made.
+*/
+inline const status_code_domain *find_domain(status_code_domain::unique_id_type id) noexcept
+{
+  const status_code_domain *ret = detail::domain_registry_find(id);
+#if SYSTEM_ERROR2_HAVE_DOMAIN_REGISTRY_SECTION
+  if(ret == nullptr && !detail::domain_registry_module<>::imported.load(std::memory_order_acquire))
+  {
+    register_module_domains();
+    ret = detail::domain_registry_find(id);
+  }
+#endif
+  return ret;
+}
+
+namespace detail
+{
+  /* As `find_domain()`, but returns null unless codes of the domain may be rebuilt from its id and
+  a value, which may come from untrusted input. Never returns a domain whose value is a pointer.
+  */
+  inline const status_code_domain *find_integral_domain(status_code_domain::unique_id_type id) noexcept
+  {
+    bool integral = false;
+    const status_code_domain *ret = domain_registry_find(id, &integral);
+#if SYSTEM_ERROR2_HAVE_DOMAIN_REGISTRY_SECTION
+    if(ret == nullptr && !domain_registry_module<>::imported.load(std::memory_order_acquire))
+    {
+      register_module_domains();
+      ret = domain_registry_find(id, &integral);
+    }
+#endif
+    return integral ? ret : nullptr;
+  }
+}  // namespace detail
+
+SYSTEM_ERROR2_NAMESPACE_END
+
+#endif
@@ -0,0 +1,160 @@
+/* Runtime registry of direct equivalence functions between pairs of domains
+(C) 2026 agent <agent@local> (3 commits)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_HPP
+#define SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_HPP
+
+#include "status_code.hpp"
+
+#ifndef SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_SLOTS
+//! The number of slots in the equivalence registry. Each registered pair of domains uses two. Must be a power of two.
+#define SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_SLOTS 256
+#endif
+
+SYSTEM_ERROR2_NAMESPACE_BEGIN
+
+/*! A function deciding whether `code1` and `code2`, which are non-empty codes of the two domains it
+was registered for in that order, are equivalent. Must not throw.
+*/
+using equivalence_function = bool (*)(const status_code<void> &code1, const status_code<void> &code2);
+
+namespace detail
+{
+  static_assert((SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_SLOTS & (SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_SLOTS - 1)) == 0, "SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_SLOTS must be a power of two");
+
+  struct equivalence_registry_slot
+  {
+    std::atomic<unsigned long long> id1;  // zero if unused, set once by whoever claims the slot
+    std::atomic<unsigned long long> id2;
+    std::atomic<bool> ready;  // set once id2 and reversed are written
+    std::atomic<bool> reversed;  // if true, call the function with the codes swapped
+    std::atomic<equivalence_function> function;  // null if unregistered
+  };
+  // A template so the table is zero initialised without a guard
+  template <class = void> struct equivalence_registry_table
+  {
+    static equivalence_registry_slot slots[SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_SLOTS];
+    static std::atomic<size_t> used;
+  };
+  template <class T> equivalence_registry_slot equivalence_registry_table<T>::slots[SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_SLOTS];
+  template <class T> std::atomic<size_t> equivalence_registry_table<T>::used;
+
+  inline size_t equivalence_registry_hash(unsigned long long id1, unsigned long long id2) noexcept
+  {
+    unsigned long long h = (id1 ^ (id2 * 0x9e3779b97f4a7c15ULL)) * 0xbf58476d1ce4e5b9ULL;
+    return static_cast<size_t>(h ^ (h >> 31));
+  }
+
+  //! Returns the registered function for codes of domains `id1` and `id2`, setting `reversed` if it takes them the other way round, or null.
+  inline equivalence_function equivalence_registry_find(unsigned long long id1, unsigned long long id2, bool &reversed) noexcept
+  {
+    using table = equivalence_registry_table<>;
+    // Keeps the cost to a single load when nothing is registered
+    if(table::used.load(std::memory_order_relaxed) == 0)
+    {
+      return nullptr;
+    }
+    const size_t mask = SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_SLOTS - 1;
+    size_t idx = equivalence_registry_hash(id1, id2) & mask;
+    for(size_t n = 0; n < SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_SLOTS; n++, idx = (idx + 1) & mask)
+    {
+      auto &slot = table::slots[idx];
+      const unsigned long long key = slot.id1.load(std::memory_order_relaxed);
+      if(key == 0)
+      {
+        return nullptr;
+      }
+      // A slot being claimed concurrently is skipped, which merely falls back to the slow path
+      if(key == id1 && slot.ready.load(std::memory_order_acquire) && slot.id2.load(std::memory_order_relaxed) == id2)
+      {
+        reversed = slot.reversed.load(std::memory_order_relaxed);
+        return slot.function.load(std::memory_order_acquire);
+      }
+    }
+    return nullptr;
+  }
+
+  inline bool equivalence_registry_insert(unsigned long long id1, unsigned long long id2, bool reversed, equivalence_function f) noexcept
+  {
+    using table = equivalence_registry_table<>;
+    const size_t mask = SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_SLOTS - 1;
+    size_t idx = equivalence_registry_hash(id1, id2) & mask;
+    for(size_t n = 0; n < SYSTEM_ERROR2_EQUIVALENCE_REGISTRY_SLOTS; n++, idx = (idx + 1) & mask)
+    {
+      auto &slot = table::slots[idx];
+      unsigned long long key = slot.id1.load(std::memory_order_relaxed);
+      if(key == 0)
+      {
+        if(f == nullptr)
+        {
+          return true;  // nothing to unregister
+        }
+        if(slot.id1.compare_exchange_strong(key, id1, std::memory_order_relaxed, std::memory_order_relaxed))
+        {
+          slot.id2.store(id2, std::memory_order_relaxed);
+          slot.reversed.store(reversed, std::memory_order_relaxed);
+          slot.function.store(f, std::memory_order_relaxed);
+          slot.ready.store(true, std::memory_order_release);
+          table::used.fetch_add(1, std::memory_order_relaxed);
+          return true;
+        }
+        // Lost the race for this slot, so key is now what the winner stored
+      }
+      if(key == id1 && slot.ready.load(std::memory_order_acquire) && slot.id2.load(std::memory_order_relaxed) == id2)
+      {
+        slot.function.store(f, std::memory_order_release);
+        return true;
+      }
+    }
+    return false;
+  }
+}  // namespace detail
+
+/*! Registers `f` to decide equivalence between codes of domains `domain1` and `domain2`, replacing any
+function previously registered for them. Thereafter `equivalent()`, and thus `operator==`, between non-empty
+codes of those domains, in either order, costs one lookup in a small lock free hash table and a call of `f`,
+instead of up to four virtual calls and two conversions to `generic_code`. Registering null unregisters.
+
+`f` must return exactly what `equivalent()` would have, else equivalence ceases to be transitive. Typed
+comparisons which `traits::static_equivalence` decides check the registry at runtime, so `f` decides
+those too, but comparisons during constant evaluation cannot see it. Comparisons of codes of the same
+domain never consult the registry.
+
+Lookups may run concurrently with registration from any thread. Registration is intended for program
+startup: concurrent registrations of the same pair may each claim a slot. Returns false if the registry
+is full, or if either domain has an id of zero, which marks unused slots.
+*/
+inline bool register_equivalence(const status_code_domain &domain1, const status_code_domain &domain2, equivalence_function f) noexcept
+{
+  const auto id1 = domain1.id(), id2 = domain2.id();
+  if(id1 == 0 || id2 == 0 || id1 == id2)
+  {
+    return false;
+  }
+  return detail::equivalence_registry_insert(id1, id2, false, f) && detail::equivalence_registry_insert(id2, id1, true, f);
+}
+
+SYSTEM_ERROR2_NAMESPACE_END
+
+#endif
@@ -54,6 +54,17 @@ static_assert(sizeof(error) == 2 * sizeof(void *), "error is not exactly two poi
 static_assert(traits::is_move_bitcopying<error>::value, "error is not move bitcopying!");
 #endif
 
+/*! An erased `system_code_wide` which is always a failure, with the same
+differences from `system_code_wide` as `error` has from `system_code`.
+Any `error` can be moved into an `error_wide`.
+*/
+using error_wide = errored_status_code<erased<system_code_wide::value_type>>;
+
+#ifndef NDEBUG
+static_assert(sizeof(error_wide) == 4 * sizeof(void *), "error_wide is not exactly four pointers in size!");
+static_assert(traits::is_move_bitcopying<error_wide>::value, "error_wide is not move bitcopying!");
+#endif
+
 SYSTEM_ERROR2_NAMESPACE_END
 
 #endif
@@ -28,8 +28,25 @@ http://www.boost.org/LICENSE_1_0.txt)
 #include "generic_code.hpp"
 #include "status_code_ptr.hpp"
 
+#ifdef SYSTEM_ERROR2_ERROR_COUNTERS
+#include "status_code_counters.hpp"
+#endif
+
 SYSTEM_ERROR2_NAMESPACE_BEGIN
 
+namespace detail
+{
+  /* The value of a failure as reported to tracers and the flight recorder. Zero for domains whose
+  values are pointers, which mean nothing outside the process and differ for every code.
+  */
+  template <class DomainType> inline intptr_t failure_diagnostic_value(const status_code<DomainType> &code) noexcept { return std::is_pointer<typename DomainType::value_type>::value ? 0 : diagnostic_value(code.value()); }
+  template <class ErasedType> inline intptr_t failure_diagnostic_value(const status_code<erased<ErasedType>> &code) noexcept
+  {
+    bool integral = false;
+    return (domain_registry_find(code.domain().id(), &integral) != nullptr && !integral) ? 0 : diagnostic_value(code.value());
+  }
+}  // namespace detail
+
 /*! A `status_code` which is always a failure. The closest equivalent to
 `std::error_code`, except it cannot be modified, and is templated.
 
@@ -45,13 +62,24 @@ template <class DomainType> class errored_status_code : public status_code<Domai
   using _base::clear;
   using _base::success;
 
-  void _check()
+  void _check() const
   {
     if(_base::success())
     {
       std::terminate();
     }
   }
+  // Fires the failure hooks. Called only where a code becomes a failure, never by conversions of one.
+  void _record() const
+  {
+    SYSTEM_ERROR2_USDT_PROBE(failure, this->domain().id(), detail::failure_diagnostic_value(*this));
+#ifdef SYSTEM_ERROR2_ERROR_COUNTERS
+    detail::record_status_code_occurrence(*this);
+#endif
+#ifdef SYSTEM_ERROR2_FLIGHT_RECORDER
+    detail::flight_recorder_record_failure(this->domain().id(), detail::failure_diagnostic_value(*this));
+#endif
+  }
 
 public:
   //! The type of the erased error code.
@@ -76,12 +104,14 @@ public:
       : _base(o)
   {
     _check();
+    _record();
   }
   //! Explicitly construct from any similarly erased status code
   explicit errored_status_code(_base &&o) noexcept(std::is_nothrow_move_constructible<_base>::value)
       : _base(static_cast<_base &&>(o))
   {
     _check();
+    _record();
   }
 
   /***** KEEP THESE IN SYNC WITH STATUS_CODE *****/
@@ -96,7 +126,6 @@ public:
   errored_status_code(T &&v, Args &&... args) noexcept(noexcept(make_status_code(std::declval<T>(), std::declval<Args>()...)))  // NOLINT
   : errored_status_code(make_status_code(static_cast<T &&>(v), static_cast<Args &&>(args)...))
   {
-    _check();
   }
   //! Explicit in-place construction.
   template <class... Args>
@@ -104,6 +133,7 @@ public:
       : _base(_, static_cast<Args &&>(args)...)
   {
     _check();
+    _record();
   }
   //! Explicit in-place construction from initialiser list.
   template <class T, class... Args>
@@ -111,18 +141,21 @@ public:
       : _base(_, il, static_cast<Args &&>(args)...)
   {
     _check();
+    _record();
   }
   //! Explicit copy construction from a `value_type`.
   explicit errored_status_code(const value_type &v) noexcept(std::is_nothrow_copy_constructible<value_type>::value)
       : _base(v)
   {
     _check();
+    _record();
   }
   //! Explicit move construction from a `value_type`.
   explicit errored_status_code(value_type &&v) noexcept(std::is_nothrow_move_constructible<value_type>::value)
       : _base(static_cast<value_type &&>(v))
   {
     _check();
+    _record();
   }
   /*! Explicit construction from an erased status code. Available only if
   `value_type` is trivially destructible and `sizeof(status_code) <= sizeof(status_code<erased<>>)`.
@@ -134,7 +167,6 @@ public:
       : errored_status_code(detail::erasure_cast<value_type>(v.value()))  // NOLINT
   {
     assert(v.domain() == this->domain());  // NOLINT
-    _check();
   }
 
   //! Return a const reference to the `value_type`.
@@ -156,10 +188,34 @@ template <class ErasedType> class errored_status_code<erased<ErasedType>> : publ
 
   void _check()
   {
+    if(this->_failure_cached())
+    {
+      return;
+    }
     if(_base::success())
     {
       std::terminate();
     }
+    // Cache that we are a failure, so failure() and success() need not ask the domain
+    if(!this->empty())
+    {
+      this->_cache_failure();
+    }
+  }
+  // Fires the failure hooks. Called only where a code becomes a failure, never by conversions of one.
+  void _record() const
+  {
+    if(this->empty())
+    {
+      return;
+    }
+    SYSTEM_ERROR2_USDT_PROBE(failure, this->domain().id(), detail::failure_diagnostic_value(*this));
+#ifdef SYSTEM_ERROR2_ERROR_COUNTERS
+    detail::record_status_code_occurrence(*this);
+#endif
+#ifdef SYSTEM_ERROR2_FLIGHT_RECORDER
+    detail::flight_recorder_record_failure(this->domain().id(), detail::failure_diagnostic_value(*this));
+#endif
   }
 
 public:
@@ -183,12 +239,14 @@ public:
       : _base(o)
   {
     _check();
+    _record();
   }
   //! Explicitly construct from any similarly erased status code
   explicit errored_status_code(_base &&o) noexcept(std::is_nothrow_move_constructible<_base>::value)
       : _base(static_cast<_base &&>(o))
   {
     _check();
+    _record();
   }
 
   /***** KEEP THESE IN SYNC WITH STATUS_CODE *****/
@@ -201,12 +259,32 @@ public:
   errored_status_code(const status_code<DomainType> &v) noexcept : _base(v)  // NOLINT
   {
     _check();
+    _record();
   }
   //! Implicit move construction from any other status code if its value type is trivially copyable or move bitcopying and it would fit into our storage
   template <class DomainType,  //
             typename std::enable_if<detail::type_erasure_is_safe<value_type, typename DomainType::value_type>::value,
                                     bool>::type = true>
   errored_status_code(status_code<DomainType> &&v) noexcept : _base(static_cast<status_code<DomainType> &&>(v))  // NOLINT
+  {
+    _check();
+    _record();
+  }
+  //! Implicit copy construction from any other errored status code, which was recorded as a failure when it became one
+  template <class DomainType,                                                                              //
+            typename std::enable_if<!detail::is_erased_status_code<status_code<DomainType>>::value         //
+                                    && std::is_trivially_copyable<typename DomainType::value_type>::value  //
+                                    && detail::type_erasure_is_safe<value_type, typename DomainType::value_type>::value,
+                                    bool>::type = true>
+  errored_status_code(const errored_status_code<DomainType> &v) noexcept : _base(static_cast<const status_code<DomainType> &>(v))  // NOLINT
+  {
+    _check();
+  }
+  //! Implicit move construction from any other errored status code, which was recorded as a failure when it became one
+  template <class DomainType,  //
+            typename std::enable_if<detail::type_erasure_is_safe<value_type, typename DomainType::value_type>::value,
+                                    bool>::type = true>
+  errored_status_code(errored_status_code<DomainType> &&v) noexcept : _base(static_cast<status_code<DomainType> &&>(v))  // NOLINT
   {
     _check();
   }
@@ -221,7 +299,6 @@ public:
   errored_status_code(T &&v, Args &&... args) noexcept(noexcept(make_status_code(std::declval<T>(), std::declval<Args>()...)))  // NOLINT
   : errored_status_code(make_status_code(static_cast<T &&>(v), static_cast<Args &&>(args)...))
   {
-    _check();
   }
   //! Return the erased `value_type` by value.
   constexpr value_type value() const noexcept { return this->_value; }
@@ -239,32 +316,32 @@ namespace traits
 //! True if the status code's are semantically equal via `equivalent()`.
 template <class DomainType1, class DomainType2> inline bool operator==(const errored_status_code<DomainType1> &a, const errored_status_code<DomainType2> &b) noexcept
 {
-  return a.equivalent(static_cast<const status_code<DomainType2> &>(b));
+  return detail::is_equivalent(static_cast<const status_code<DomainType1> &>(a), static_cast<const status_code<DomainType2> &>(b));
 }
 //! True if the status code's are semantically equal via `equivalent()`.
 template <class DomainType1, class DomainType2> inline bool operator==(const status_code<DomainType1> &a, const errored_status_code<DomainType2> &b) noexcept
 {
-  return a.equivalent(static_cast<const status_code<DomainType2> &>(b));
+  return detail::is_equivalent(static_cast<const status_code<DomainType1> &>(a), static_cast<const status_code<DomainType2> &>(b));
 }
 //! True if the status code's are semantically equal via `equivalent()`.
 template <class DomainType1, class DomainType2> inline bool operator==(const errored_status_code<DomainType1> &a, const status_code<DomainType2> &b) noexcept
 {
-  return static_cast<const status_code<DomainType1> &>(a).equivalent(b);
+  return detail::is_equivalent(static_cast<const status_code<DomainType1> &>(a), b);
 }
 //! True if the status code's are not semantically equal via `equivalent()`.
 template <class DomainType1, class DomainType2> inline bool operator!=(const errored_status_code<DomainType1> &a, const errored_status_code<DomainType2> &b) noexcept
 {
-  return !a.equivalent(static_cast<const status_code<DomainType2> &>(b));
+  return !detail::is_equivalent(static_cast<const status_code<DomainType1> &>(a), static_cast<const status_code<DomainType2> &>(b));
 }
 //! True if the status code's are not semantically equal via `equivalent()`.
 template <class DomainType1, class DomainType2> inline bool operator!=(const status_code<DomainType1> &a, const errored_status_code<DomainType2> &b) noexcept
 {
-  return !a.equivalent(static_cast<const status_code<DomainType2> &>(b));
+  return !detail::is_equivalent(static_cast<const status_code<DomainType1> &>(a), static_cast<const status_code<DomainType2> &>(b));
 }
 //! True if the status code's are not semantically equal via `equivalent()`.
 template <class DomainType1, class DomainType2> inline bool operator!=(const errored_status_code<DomainType1> &a, const status_code<DomainType2> &b) noexcept
 {
-  return !static_cast<const status_code<DomainType1> &>(a).equivalent(b);
+  return !detail::is_equivalent(static_cast<const status_code<DomainType1> &>(a), b);
 }
 //! True if the status code's are semantically equal via `equivalent()` to `make_status_code(T)`.
 template <class DomainType1, class T,                                                                       //
@@ -273,7 +350,7 @@ template <class DomainType1, class T,
 inline bool
 operator==(const errored_status_code<DomainType1> &a, const T &b)
 {
-  return a.equivalent(make_status_code(b));
+  return detail::is_equivalent(static_cast<const status_code<DomainType1> &>(a), make_status_code(b));
 }
 //! True if the status code's are semantically equal via `equivalent()` to `make_status_code(T)`.
 template <class T, class DomainType1,                                                                       //
@@ -282,7 +359,7 @@ template <class T, class DomainType1,
 inline bool
 operator==(const T &a, const errored_status_code<DomainType1> &b)
 {
-  return b.equivalent(make_status_code(a));
+  return detail::is_equivalent(static_cast<const status_code<DomainType1> &>(b), make_status_code(a));
 }
 //! True if the status code's are not semantically equal via `equivalent()` to `make_status_code(T)`.
 template <class DomainType1, class T,                                                                       //
@@ -291,7 +368,7 @@ template <class DomainType1, class T,
 inline bool
 operator!=(const errored_status_code<DomainType1> &a, const T &b)
 {
-  return !a.equivalent(make_status_code(b));
+  return !detail::is_equivalent(static_cast<const status_code<DomainType1> &>(a), make_status_code(b));
 }
 //! True if the status code's are semantically equal via `equivalent()` to `make_status_code(T)`.
 template <class T, class DomainType1,                                                                       //
@@ -300,7 +377,7 @@ template <class T, class DomainType1,
 inline bool
 operator!=(const T &a, const errored_status_code<DomainType1> &b)
 {
-  return !b.equivalent(make_status_code(a));
+  return !detail::is_equivalent(static_cast<const status_code<DomainType1> &>(b), make_status_code(a));
 }
 
 
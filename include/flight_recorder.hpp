@@ -0,0 +1,242 @@
+/* Per-thread recorder of the most recent failures
+(C) 2026 agent <agent@local> (3 commits)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+// Included by config.hpp when SYSTEM_ERROR2_FLIGHT_RECORDER is defined, so the default fatal
+// exit can dump the recorder. Including config.hpp first makes this work if included directly.
+#include "config.hpp"
+
+#ifndef SYSTEM_ERROR2_FLIGHT_RECORDER_HPP
+#define SYSTEM_ERROR2_FLIGHT_RECORDER_HPP
+
+#include <cstdint>
+
+#ifndef SYSTEM_ERROR2_FLIGHT_RECORDER_RECORDS
+//! The number of most recent failures remembered per thread by the flight recorder. Must be a power of two.
+#define SYSTEM_ERROR2_FLIGHT_RECORDER_RECORDS 16
+#endif
+/* If defined, `SYSTEM_ERROR2_FLIGHT_RECORDER_TIMESTAMP(seq)` gives the timestamp of each record, where
+`seq` is the number of records the thread's ring has had. By default the time stamp counter is read, which
+costs tens of cycles, and far more under hypervisors which trap it. Defining it to `(seq)` makes recording
+only a few stores.
+*/
+#ifndef SYSTEM_ERROR2_FLIGHT_RECORDER_THREADS
+//! The number of threads which can concurrently own a ring of the flight recorder. Failures on any more threads are not recorded.
+#define SYSTEM_ERROR2_FLIGHT_RECORDER_THREADS 64
+#endif
+
+SYSTEM_ERROR2_NAMESPACE_BEGIN
+
+//! A failure remembered by the flight recorder
+struct flight_recorder_record
+{
+  //! The id of the domain of the failure
+  uint64_t domain_id;
+  //! The value of the failure, erased into an `intptr_t`, or zero if it would not erase into one
+  intptr_t value;
+  //! The time stamp counter when the failure was constructed, or a per-thread sequence number if there is none
+  uint64_t timestamp;
+};
+
+namespace detail
+{
+  static_assert((SYSTEM_ERROR2_FLIGHT_RECORDER_RECORDS & (SYSTEM_ERROR2_FLIGHT_RECORDER_RECORDS - 1)) == 0, "SYSTEM_ERROR2_FLIGHT_RECORDER_RECORDS must be a power of two");
+
+  struct alignas(64) flight_recorder_ring
+  {
+    flight_recorder_record records[SYSTEM_ERROR2_FLIGHT_RECORDER_RECORDS];
+    std::atomic<uint64_t> head;  // count of records ever written
+    std::atomic<bool> owned;
+  };
+  // A template so the rings have static storage duration and are zero initialised without a guard.
+  // Rings are never freed, so they can be dumped even after their thread has exited.
+  template <class = void> struct flight_recorder_table
+  {
+    static flight_recorder_ring rings[SYSTEM_ERROR2_FLIGHT_RECORDER_THREADS];
+  };
+  template <class T> flight_recorder_ring flight_recorder_table<T>::rings[SYSTEM_ERROR2_FLIGHT_RECORDER_THREADS];
+
+  // Trivially destructible, so it remains usable by thread_local destructors which run after the releaser
+  struct flight_recorder_thread_state
+  {
+    flight_recorder_ring *ring;
+    bool assigned, dead;
+  };
+  inline flight_recorder_thread_state &flight_recorder_state() noexcept
+  {
+    static thread_local flight_recorder_thread_state v;
+    return v;
+  }
+  struct flight_recorder_releaser
+  {
+    flight_recorder_releaser() = default;
+    flight_recorder_releaser(const flight_recorder_releaser &) = delete;
+    flight_recorder_releaser(flight_recorder_releaser &&) = delete;
+    flight_recorder_releaser &operator=(const flight_recorder_releaser &) = delete;
+    flight_recorder_releaser &operator=(flight_recorder_releaser &&) = delete;
+    ~flight_recorder_releaser()
+    {
+      auto &s = flight_recorder_state();
+      // The ring keeps its records, so they appear in a dump until another thread overwrites them
+      s.ring->owned.store(false, std::memory_order_release);
+      s.ring = nullptr;
+      s.dead = true;
+    }
+  };
+  inline void flight_recorder_assign(flight_recorder_thread_state &s) noexcept
+  {
+    s.assigned = true;
+    if(s.dead)
+    {
+      return;
+    }
+    for(auto &ring : flight_recorder_table<>::rings)
+    {
+      bool expected = false;
+      if(!ring.owned.load(std::memory_order_relaxed) && ring.owned.compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed))
+      {
+        s.ring = &ring;
+        static thread_local flight_recorder_releaser r;
+        (void) r;
+        return;
+      }
+    }
+  }
+
+  inline uint64_t flight_recorder_timestamp(uint64_t seq) noexcept
+  {
+#if defined(SYSTEM_ERROR2_FLIGHT_RECORDER_TIMESTAMP)
+    return SYSTEM_ERROR2_FLIGHT_RECORDER_TIMESTAMP(seq);
+#elif SYSTEM_ERROR2_HAVE_TIMESTAMP_COUNTER
+    (void) seq;
+    return read_timestamp_counter();
+#else
+    return seq;
+#endif
+  }
+
+  //! Remembers a failure in the calling thread's ring. Wait free once the thread owns a ring.
+  inline void flight_recorder_record_failure(uint64_t domain_id, intptr_t value) noexcept
+  {
+    auto &s = flight_recorder_state();
+    if(!s.assigned)
+    {
+      flight_recorder_assign(s);
+    }
+    if(s.ring == nullptr)
+    {
+      return;
+    }
+    // Only this thread writes to its ring
+    const uint64_t head = s.ring->head.load(std::memory_order_relaxed);
+    auto &r = s.ring->records[head & (SYSTEM_ERROR2_FLIGHT_RECORDER_RECORDS - 1)];
+    r.domain_id = domain_id;
+    r.value = value;
+    r.timestamp = flight_recorder_timestamp(head);
+    s.ring->head.store(head + 1, std::memory_order_release);
+  }
+
+  // Formats without the C library, so it can be used when the process is failing
+  inline char *flight_recorder_append(char *p, const char *s) noexcept
+  {
+    while(*s != 0)
+    {
+      *p++ = *s++;
+    }
+    return p;
+  }
+  inline char *flight_recorder_append_hex(char *p, uint64_t v) noexcept
+  {
+    static constexpr const char digits[] = "0123456789abcdef";
+    *p++ = '0';
+    *p++ = 'x';
+    for(int shift = 60; shift >= 0; shift -= 4)
+    {
+      *p++ = digits[(v >> shift) & 15];
+    }
+    return p;
+  }
+  inline char *flight_recorder_append_dec(char *p, intptr_t v) noexcept
+  {
+    char buffer[24];
+    char *e = buffer + sizeof(buffer);
+    char *b = e;
+    uintptr_t u = (v < 0) ? (0 - static_cast<uintptr_t>(v)) : static_cast<uintptr_t>(v);
+    do
+    {
+      *--b = static_cast<char>('0' + u % 10);
+      u /= 10;
+    } while(u != 0);
+    if(v < 0)
+    {
+      *p++ = '-';
+    }
+    while(b != e)
+    {
+      *p++ = *b++;
+    }
+    return p;
+  }
+}  // namespace detail
+
+/*! Writes the most recent failures remembered by each thread to file descriptor `fd`, oldest first,
+using only `write()`. Called by the default `SYSTEM_ERROR2_FATAL`; custom fatal handlers may call it too.
+Records being written concurrently by other threads may be torn.
+*/
+inline void flight_recorder_dump(int fd) noexcept
+{
+  using namespace detail::avoid_stdio_include;
+  char line[128];
+  char *p = detail::flight_recorder_append(line, "status code flight recorder, oldest first:\n");
+  write(fd, line, static_cast<size_t>(p - line));
+  unsigned idx = 0;
+  for(auto &ring : detail::flight_recorder_table<>::rings)
+  {
+    const uint64_t head = ring.head.load(std::memory_order_acquire);
+    if(head != 0)
+    {
+      p = detail::flight_recorder_append(line, "ring ");
+      p = detail::flight_recorder_append_dec(p, static_cast<intptr_t>(idx));
+      p = detail::flight_recorder_append(p, ring.owned.load(std::memory_order_relaxed) ? ":\n" : " (thread exited):\n");
+      write(fd, line, static_cast<size_t>(p - line));
+      const uint64_t begin = (head > SYSTEM_ERROR2_FLIGHT_RECORDER_RECORDS) ? head - SYSTEM_ERROR2_FLIGHT_RECORDER_RECORDS : 0;
+      for(uint64_t n = begin; n < head; n++)
+      {
+        const auto &r = ring.records[n & (SYSTEM_ERROR2_FLIGHT_RECORDER_RECORDS - 1)];
+        p = detail::flight_recorder_append(line, "  timestamp=");
+        p = detail::flight_recorder_append_hex(p, r.timestamp);
+        p = detail::flight_recorder_append(p, " domain=");
+        p = detail::flight_recorder_append_hex(p, r.domain_id);
+        p = detail::flight_recorder_append(p, " value=");
+        p = detail::flight_recorder_append_dec(p, r.value);
+        *p++ = '\n';
+        write(fd, line, static_cast<size_t>(p - line));
+      }
+    }
+    ++idx;
+  }
+}
+
+SYSTEM_ERROR2_NAMESPACE_END
+
+#endif
@@ -0,0 +1,122 @@
+/* Formatting of status codes into caller supplied buffers, and via std::format and fmt
+(C) 2026 agent <agent@local> (2 commits)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef SYSTEM_ERROR2_FORMAT_SUPPORT_HPP
+#define SYSTEM_ERROR2_FORMAT_SUPPORT_HPP
+
+#include "error.hpp"
+
+#ifndef SYSTEM_ERROR2_FORMAT_BUFFER_SIZE
+//! The size of the stack buffer into which the `std::format` and fmt formatters render a status code. Longer renderings are truncated.
+#define SYSTEM_ERROR2_FORMAT_BUFFER_SIZE 512
+#endif
+
+#ifndef SYSTEM_ERROR2_HAVE_STD_FORMAT
+#if(__cplusplus >= 202002L || (defined(_MSVC_LANG) && _MSVC_LANG >= 202002L)) && defined(__has_include)
+#if __has_include(<format>)
+#include <format>
+#endif
+#endif
+#ifdef __cpp_lib_format
+//! True if `std::formatter` is specialised for status codes. Defaults to whether `<format>` is available.
+#define SYSTEM_ERROR2_HAVE_STD_FORMAT 1
+#else
+#define SYSTEM_ERROR2_HAVE_STD_FORMAT 0
+#endif
+#endif
+
+SYSTEM_ERROR2_NAMESPACE_BEGIN
+
+/*! Write "domain: message" for `code`, or "(empty)", into `buffer` of `bytes` bytes, truncated and null terminated,
+returning the length it would have had if not truncated, as with `snprintf()`. Built on `format_message_to()`,
+so for the generic, POSIX and `getaddrinfo()` domains, and domains wrapping them, this never allocates nor locks,
+and is safe to call from within a signal handler.
+*/
+inline size_t format_status_code_to(const status_code<void> &code, char *buffer, size_t bytes) noexcept
+{
+  detail::message_writer w(buffer, bytes);
+  if(code.empty())
+  {
+    w.append("(empty)", 7);
+    return w.finish();
+  }
+  {
+    const auto name = code.domain().name();
+    w.append(name.data(), name.size());
+  }
+  w.append(": ", 2);
+  const size_t prefix = w.finish();
+  const size_t length = (prefix + 1 < bytes) ? code.format_message_to(buffer + prefix, bytes - prefix) : code.format_message_to(nullptr, 0);
+  return prefix + length;
+}
+
+namespace detail
+{
+  // Common to the std::format and fmt formatters, which take no format specification
+  struct status_code_formatter
+  {
+    template <class ParseContext> constexpr auto parse(ParseContext &ctx) -> decltype(ctx.begin()) { return ctx.begin(); }
+    template <class FormatContext> auto format(const status_code<void> &code, FormatContext &ctx) const -> decltype(ctx.out())
+    {
+      char buffer[SYSTEM_ERROR2_FORMAT_BUFFER_SIZE];
+      size_t length = format_status_code_to(code, buffer, sizeof(buffer));
+      if(length >= sizeof(buffer))
+      {
+        length = sizeof(buffer) - 1;
+      }
+      auto out = ctx.out();
+      for(size_t n = 0; n < length; n++)
+      {
+        *out++ = buffer[n];
+      }
+      return out;
+    }
+  };
+}  // namespace detail
+
+SYSTEM_ERROR2_NAMESPACE_END
+
+#if SYSTEM_ERROR2_HAVE_STD_FORMAT
+//! Formats a status code as "domain: message" with `std::format`, without allocating for the message where the domain supports it.
+template <class DomainType> struct std::formatter<SYSTEM_ERROR2_NAMESPACE::status_code<DomainType>, char> : SYSTEM_ERROR2_NAMESPACE::detail::status_code_formatter
+{
+};
+//! Formats an errored status code as "domain: message" with `std::format`, without allocating for the message where the domain supports it.
+template <class DomainType> struct std::formatter<SYSTEM_ERROR2_NAMESPACE::errored_status_code<DomainType>, char> : SYSTEM_ERROR2_NAMESPACE::detail::status_code_formatter
+{
+};
+#endif
+
+#ifdef FMT_VERSION
+//! Formats a status code as "domain: message" with fmt, if fmt was included first.
+template <class DomainType> struct fmt::formatter<SYSTEM_ERROR2_NAMESPACE::status_code<DomainType>, char> : SYSTEM_ERROR2_NAMESPACE::detail::status_code_formatter
+{
+};
+//! Formats an errored status code as "domain: message" with fmt, if fmt was included first.
+template <class DomainType> struct fmt::formatter<SYSTEM_ERROR2_NAMESPACE::errored_status_code<DomainType>, char> : SYSTEM_ERROR2_NAMESPACE::detail::status_code_formatter
+{
+};
+#endif
+
+#endif
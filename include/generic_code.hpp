@@ -25,6 +25,7 @@ http://www.boost.org/LICENSE_1_0.txt)
 #ifndef SYSTEM_ERROR2_GENERIC_CODE_HPP
 #define SYSTEM_ERROR2_GENERIC_CODE_HPP
 
+#include "equivalence_registry.hpp"
 #include "status_error.hpp"
 
 #include <cerrno>  // for error constants
@@ -118,174 +119,221 @@ enum class errc : int
 
 namespace detail
 {
-  SYSTEM_ERROR2_CONSTEXPR14 inline const char *generic_code_message(errc code) noexcept
+  template <size_t... I> struct index_list
   {
-    switch(code)
+  };
+  template <size_t N, size_t... I> struct make_index_list : make_index_list<N - 1, N - 1, I...>
+  {
+  };
+  template <size_t... I> struct make_index_list<0, I...>
+  {
+    using type = index_list<I...>;
+  };
+
+  /* The messages for all the generic codes, null terminated, in one contiguous blob, with the offset and
+  length of each. Host errc values differ between platforms, so they are looked up via an index built at
+  compile time. A template so these are defined once in the program, without needing C++17 inline variables.
+  */
+  template <class = void> struct generic_code_messages
+  {
+    struct entry
+    {
+      errc code;
+      unsigned short offset, length;
+    };
+    static constexpr char blob[] =  //
+    "Success\0"
+    "Address family not supported by protocol\0"
+    "Address already in use\0"
+    "Cannot assign requested address\0"
+    "Transport endpoint is already connected\0"
+    "Argument list too long\0"
+    "Numerical argument out of domain\0"
+    "Bad address\0"
+    "Bad file descriptor\0"
+    "Bad message\0"
+    "Broken pipe\0"
+    "Software caused connection abort\0"
+    "Operation already in progress\0"
+    "Connection refused\0"
+    "Connection reset by peer\0"
+    "Invalid cross-device link\0"
+    "Destination address required\0"
+    "Device or resource busy\0"
+    "Directory not empty\0"
+    "Exec format error\0"
+    "File exists\0"
+    "File too large\0"
+    "File name too long\0"
+    "Function not implemented\0"
+    "No route to host\0"
+    "Identifier removed\0"
+    "Invalid or incomplete multibyte or wide character\0"
+    "Inappropriate ioctl for device\0"
+    "Interrupted system call\0"
+    "Invalid argument\0"
+    "Illegal seek\0"
+    "Input/output error\0"
+    "Is a directory\0"
+    "Message too long\0"
+    "Network is down\0"
+    "Network dropped connection on reset\0"
+    "Network is unreachable\0"
+    "No buffer space available\0"
+    "No child processes\0"
+    "Link has been severed\0"
+    "No locks available\0"
+    "No message of desired type\0"
+    "Protocol not available\0"
+    "No space left on device\0"
+    "Out of streams resources\0"
+    "No such device or address\0"
+    "No such device\0"
+    "No such file or directory\0"
+    "No such process\0"
+    "Not a directory\0"
+    "Socket operation on non-socket\0"
+    "Device not a stream\0"
+    "Transport endpoint is not connected\0"
+    "Cannot allocate memory\0"
+    "Operation not supported\0"
+    "Operation canceled\0"
+    "Operation now in progress\0"
+    "Operation not permitted\0"
+    "Operation not supported\0"
+    "Resource temporarily unavailable\0"
+    "Owner died\0"
+    "Permission denied\0"
+    "Protocol error\0"
+    "Protocol not supported\0"
+    "Read-only file system\0"
+    "Resource deadlock avoided\0"
+    "Resource temporarily unavailable\0"
+    "Numerical result out of range\0"
+    "State not recoverable\0"
+    "Timer expired\0"
+    "Text file busy\0"
+    "Connection timed out\0"
+    "Too many open files in system\0"
+    "Too many open files\0"
+    "Too many links\0"
+    "Too many levels of symbolic links\0"
+    "Value too large for defined data type\0"
+    "Protocol wrong type for socket\0";
+    static constexpr entry entries[] = {
+    {errc::success, 0, 7},
+    {errc::address_family_not_supported, 8, 40},
+    {errc::address_in_use, 49, 22},
+    {errc::address_not_available, 72, 31},
+    {errc::already_connected, 104, 39},
+    {errc::argument_list_too_long, 144, 22},
+    {errc::argument_out_of_domain, 167, 32},
+    {errc::bad_address, 200, 11},
+    {errc::bad_file_descriptor, 212, 19},
+    {errc::bad_message, 232, 11},
+    {errc::broken_pipe, 244, 11},
+    {errc::connection_aborted, 256, 32},
+    {errc::connection_already_in_progress, 289, 29},
+    {errc::connection_refused, 319, 18},
+    {errc::connection_reset, 338, 24},
+    {errc::cross_device_link, 363, 25},
+    {errc::destination_address_required, 389, 28},
+    {errc::device_or_resource_busy, 418, 23},
+    {errc::directory_not_empty, 442, 19},
+    {errc::executable_format_error, 462, 17},
+    {errc::file_exists, 480, 11},
+    {errc::file_too_large, 492, 14},
+    {errc::filename_too_long, 507, 18},
+    {errc::function_not_supported, 526, 24},
+    {errc::host_unreachable, 551, 16},
+    {errc::identifier_removed, 568, 18},
+    {errc::illegal_byte_sequence, 587, 49},
+    {errc::inappropriate_io_control_operation, 637, 30},
+    {errc::interrupted, 668, 23},
+    {errc::invalid_argument, 692, 16},
+    {errc::invalid_seek, 709, 12},
+    {errc::io_error, 722, 18},
+    {errc::is_a_directory, 741, 14},
+    {errc::message_size, 756, 16},
+    {errc::network_down, 773, 15},
+    {errc::network_reset, 789, 35},
+    {errc::network_unreachable, 825, 22},
+    {errc::no_buffer_space, 848, 25},
+    {errc::no_child_process, 874, 18},
+    {errc::no_link, 893, 21},
+    {errc::no_lock_available, 915, 18},
+    {errc::no_message, 934, 26},
+    {errc::no_protocol_option, 961, 22},
+    {errc::no_space_on_device, 984, 23},
+    {errc::no_stream_resources, 1008, 24},
+    {errc::no_such_device_or_address, 1033, 25},
+    {errc::no_such_device, 1059, 14},
+    {errc::no_such_file_or_directory, 1074, 25},
+    {errc::no_such_process, 1100, 15},
+    {errc::not_a_directory, 1116, 15},
+    {errc::not_a_socket, 1132, 30},
+    {errc::not_a_stream, 1163, 19},
+    {errc::not_connected, 1183, 35},
+    {errc::not_enough_memory, 1219, 22},
+    {errc::not_supported, 1242, 23},
+    {errc::operation_canceled, 1266, 18},
+    {errc::operation_in_progress, 1285, 25},
+    {errc::operation_not_permitted, 1311, 23},
+    {errc::operation_not_supported, 1335, 23},
+    {errc::operation_would_block, 1359, 32},
+    {errc::owner_dead, 1392, 10},
+    {errc::permission_denied, 1403, 17},
+    {errc::protocol_error, 1421, 14},
+    {errc::protocol_not_supported, 1436, 22},
+    {errc::read_only_file_system, 1459, 21},
+    {errc::resource_deadlock_would_occur, 1481, 25},
+    {errc::resource_unavailable_try_again, 1507, 32},
+    {errc::result_out_of_range, 1540, 29},
+    {errc::state_not_recoverable, 1570, 21},
+    {errc::stream_timeout, 1592, 13},
+    {errc::text_file_busy, 1606, 14},
+    {errc::timed_out, 1621, 20},
+    {errc::too_many_files_open_in_system, 1642, 29},
+    {errc::too_many_files_open, 1672, 19},
+    {errc::too_many_links, 1692, 14},
+    {errc::too_many_symbolic_link_levels, 1707, 33},
+    {errc::value_too_large, 1741, 37},
+    {errc::wrong_protocol_type, 1779, 30}};
+    static constexpr size_t count = sizeof(entries) / sizeof(entries[0]);
+    //! One plus the index of the first entry for `v`, or zero if none.
+    static constexpr unsigned char find(int v, size_t i = 0) noexcept { return (i == count) ? 0 : (static_cast<int>(entries[i].code) == v) ? static_cast<unsigned char>(i + 1) : find(v, i + 1); }
+  };
+  template <class T> constexpr char generic_code_messages<T>::blob[];
+  template <class T> constexpr typename generic_code_messages<T>::entry generic_code_messages<T>::entries[];
+
+  template <class Indices> struct generic_code_message_index;
+  template <size_t... I> struct generic_code_message_index<index_list<I...>>
+  {
+    //! One plus the index of the entry for each errc value less than 256, or zero if none.
+    static constexpr unsigned char map[sizeof...(I)] = {generic_code_messages<>::find(static_cast<int>(I))...};
+  };
+  template <size_t... I> constexpr unsigned char generic_code_message_index<index_list<I...>>::map[sizeof...(I)];
+
+  //! One plus the index of the entry for `code`, or zero if none.
+  SYSTEM_ERROR2_CONSTEXPR14 inline unsigned generic_code_message_lookup(errc code) noexcept
+  {
+    using index = generic_code_message_index<make_index_list<256>::type>;
+    const auto v = static_cast<unsigned>(code);
+    return (v < 256) ? index::map[v] : generic_code_messages<>::find(static_cast<int>(code));
+  }
+  //! The message for `code`, or "unknown".
+  SYSTEM_ERROR2_CONSTEXPR14 inline status_code_domain::message_view_type generic_code_message_view(errc code) noexcept
+  {
+    using messages = generic_code_messages<>;
+    const unsigned i = generic_code_message_lookup(code);
+    if(i == 0)
     {
-    case errc::success:
-      return "Success";
-    case errc::address_family_not_supported:
-      return "Address family not supported by protocol";
-    case errc::address_in_use:
-      return "Address already in use";
-    case errc::address_not_available:
-      return "Cannot assign requested address";
-    case errc::already_connected:
-      return "Transport endpoint is already connected";
-    case errc::argument_list_too_long:
-      return "Argument list too long";
-    case errc::argument_out_of_domain:
-      return "Numerical argument out of domain";
-    case errc::bad_address:
-      return "Bad address";
-    case errc::bad_file_descriptor:
-      return "Bad file descriptor";
-    case errc::bad_message:
-      return "Bad message";
-    case errc::broken_pipe:
-      return "Broken pipe";
-    case errc::connection_aborted:
-      return "Software caused connection abort";
-    case errc::connection_already_in_progress:
-      return "Operation already in progress";
-    case errc::connection_refused:
-      return "Connection refused";
-    case errc::connection_reset:
-      return "Connection reset by peer";
-    case errc::cross_device_link:
-      return "Invalid cross-device link";
-    case errc::destination_address_required:
-      return "Destination address required";
-    case errc::device_or_resource_busy:
-      return "Device or resource busy";
-    case errc::directory_not_empty:
-      return "Directory not empty";
-    case errc::executable_format_error:
-      return "Exec format error";
-    case errc::file_exists:
-      return "File exists";
-    case errc::file_too_large:
-      return "File too large";
-    case errc::filename_too_long:
-      return "File name too long";
-    case errc::function_not_supported:
-      return "Function not implemented";
-    case errc::host_unreachable:
-      return "No route to host";
-    case errc::identifier_removed:
-      return "Identifier removed";
-    case errc::illegal_byte_sequence:
-      return "Invalid or incomplete multibyte or wide character";
-    case errc::inappropriate_io_control_operation:
-      return "Inappropriate ioctl for device";
-    case errc::interrupted:
-      return "Interrupted system call";
-    case errc::invalid_argument:
-      return "Invalid argument";
-    case errc::invalid_seek:
-      return "Illegal seek";
-    case errc::io_error:
-      return "Input/output error";
-    case errc::is_a_directory:
-      return "Is a directory";
-    case errc::message_size:
-      return "Message too long";
-    case errc::network_down:
-      return "Network is down";
-    case errc::network_reset:
-      return "Network dropped connection on reset";
-    case errc::network_unreachable:
-      return "Network is unreachable";
-    case errc::no_buffer_space:
-      return "No buffer space available";
-    case errc::no_child_process:
-      return "No child processes";
-    case errc::no_link:
-      return "Link has been severed";
-    case errc::no_lock_available:
-      return "No locks available";
-    case errc::no_message:
-      return "No message of desired type";
-    case errc::no_protocol_option:
-      return "Protocol not available";
-    case errc::no_space_on_device:
-      return "No space left on device";
-    case errc::no_stream_resources:
-      return "Out of streams resources";
-    case errc::no_such_device_or_address:
-      return "No such device or address";
-    case errc::no_such_device:
-      return "No such device";
-    case errc::no_such_file_or_directory:
-      return "No such file or directory";
-    case errc::no_such_process:
-      return "No such process";
-    case errc::not_a_directory:
-      return "Not a directory";
-    case errc::not_a_socket:
-      return "Socket operation on non-socket";
-    case errc::not_a_stream:
-      return "Device not a stream";
-    case errc::not_connected:
-      return "Transport endpoint is not connected";
-    case errc::not_enough_memory:
-      return "Cannot allocate memory";
-#if ENOTSUP != EOPNOTSUPP
-    case errc::not_supported:
-      return "Operation not supported";
-#endif
-    case errc::operation_canceled:
-      return "Operation canceled";
-    case errc::operation_in_progress:
-      return "Operation now in progress";
-    case errc::operation_not_permitted:
-      return "Operation not permitted";
-    case errc::operation_not_supported:
-      return "Operation not supported";
-#if EAGAIN != EWOULDBLOCK
-    case errc::operation_would_block:
-      return "Resource temporarily unavailable";
-#endif
-    case errc::owner_dead:
-      return "Owner died";
-    case errc::permission_denied:
-      return "Permission denied";
-    case errc::protocol_error:
-      return "Protocol error";
-    case errc::protocol_not_supported:
-      return "Protocol not supported";
-    case errc::read_only_file_system:
-      return "Read-only file system";
-    case errc::resource_deadlock_would_occur:
-      return "Resource deadlock avoided";
-    case errc::resource_unavailable_try_again:
-      return "Resource temporarily unavailable";
-    case errc::result_out_of_range:
-      return "Numerical result out of range";
-    case errc::state_not_recoverable:
-      return "State not recoverable";
-    case errc::stream_timeout:
-      return "Timer expired";
-    case errc::text_file_busy:
-      return "Text file busy";
-    case errc::timed_out:
-      return "Connection timed out";
-    case errc::too_many_files_open_in_system:
-      return "Too many open files in system";
-    case errc::too_many_files_open:
-      return "Too many open files";
-    case errc::too_many_links:
-      return "Too many links";
-    case errc::too_many_symbolic_link_levels:
-      return "Too many levels of symbolic links";
-    case errc::value_too_large:
-      return "Value too large for defined data type";
-    case errc::wrong_protocol_type:
-      return "Protocol wrong type for socket";
-    default:
       return "unknown";
     }
+    const auto &e = messages::entries[i - 1];
+    return {messages::blob + e.offset, e.length};
   }
+  SYSTEM_ERROR2_CONSTEXPR14 inline const char *generic_code_message(errc code) noexcept { return generic_code_message_view(code).data(); }
 }  // namespace detail
 
 /*! The implementation of the domain for generic status codes, those mapped by `errc` (POSIX).
@@ -293,7 +341,7 @@ namespace detail
 class _generic_code_domain : public status_code_domain
 {
   template <class> friend class status_code;
-  template <class StatusCode> friend class detail::indirecting_domain;
+  template <class StatusCode, class Allocator> friend class detail::indirecting_domain;
   using _base = status_code_domain;
 
 public:
@@ -303,7 +351,7 @@ public:
 
 public:
   //! Default constructor
-  constexpr explicit _generic_code_domain(typename _base::unique_id_type id = 0x746d6354f4f733e9) noexcept : _base(id) {}
+  constexpr explicit _generic_code_domain(typename _base::unique_id_type id = 0x746d6354f4f733e9) noexcept : _base(id, id == 0x746d6354f4f733e9) {}
   _generic_code_domain(const _generic_code_domain &) = default;
   _generic_code_domain(_generic_code_domain &&) = default;
   _generic_code_domain &operator=(const _generic_code_domain &) = default;
@@ -312,13 +360,15 @@ public:
 
   //! Constexpr singleton getter. Returns the constexpr generic_code_domain variable.
   static inline constexpr const _generic_code_domain &get();
+  //! True if a code of this domain with value `v` is a failure, without need of a virtual function call.
+  static constexpr bool _failure_of(const value_type &v) noexcept { return v != errc::success; }
 
   virtual _base::string_ref name() const noexcept override { return string_ref("generic domain"); }  // NOLINT
 protected:
   virtual bool _do_failure(const status_code<void> &code) const noexcept override  // NOLINT
   {
-    assert(code.domain() == *this);                                           // NOLINT
-    return static_cast<const generic_code &>(code).value() != errc::success;  // NOLINT
+    assert(code.domain() == *this);                                       // NOLINT
+    return _failure_of(static_cast<const generic_code &>(code).value());  // NOLINT
   }
   virtual bool _do_equivalent(const status_code<void> &code1, const status_code<void> &code2) const noexcept override  // NOLINT
   {
@@ -340,7 +390,24 @@ protected:
   {
     assert(code.domain() == *this);                           // NOLINT
     const auto &c = static_cast<const generic_code &>(code);  // NOLINT
-    return string_ref(detail::generic_code_message(c.value()));
+    const auto view = detail::generic_code_message_view(c.value());
+    // No thunk, so copies and destruction of the string ref are trivial
+    return string_ref(view.data(), view.size(), nullptr, nullptr, nullptr, nullptr);
+  }
+  virtual size_t _do_format_message(const status_code<void> &code, char *buffer, size_t bytes) const noexcept override  // NOLINT
+  {
+    assert(code.domain() == *this);                           // NOLINT
+    const auto &c = static_cast<const generic_code &>(code);  // NOLINT
+    const auto view = detail::generic_code_message_view(c.value());
+    detail::message_writer w(buffer, bytes);
+    w.append(view.data(), view.size());
+    return w.finish();
+  }
+  virtual message_view_type _do_message_view(const status_code<void> &code) const noexcept override  // NOLINT
+  {
+    assert(code.domain() == *this);                           // NOLINT
+    const auto &c = static_cast<const generic_code &>(code);  // NOLINT
+    return detail::generic_code_message_view(c.value());
   }
 #if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(STANDARDESE_IS_IN_THE_HOUSE)
   SYSTEM_ERROR2_NORETURN virtual void _do_throw_exception(const status_code<void> &code) const override  // NOLINT
@@ -355,6 +422,7 @@ protected:
 using generic_error = status_error<_generic_code_domain>;
 //! A constexpr source variable for the generic code domain, which is that of `errc` (POSIX). Returned by `_generic_code_domain::get()`.
 constexpr _generic_code_domain generic_code_domain;
+SYSTEM_ERROR2_REGISTER_DOMAIN(generic_code_domain);
 inline constexpr const _generic_code_domain &_generic_code_domain::get()
 {
   return generic_code_domain;
@@ -365,6 +433,63 @@ SYSTEM_ERROR2_CONSTEXPR14 inline generic_code make_status_code(errc c) noexcept
   return generic_code(in_place, c);
 }
 
+/*! A constexpr set of `errc` values, for testing a status code against many of them at once with
+`status_code<void>::in()`. Only values in the range 0 to 255 can be members, which are all of the
+`errc` values on all known platforms; `errc::unknown` never is.
+*/
+class errc_set
+{
+  static constexpr unsigned _words = 4;
+  unsigned long long _bits[_words];
+
+  static constexpr unsigned long long _bit(unsigned word, errc c) noexcept { return (static_cast<unsigned>(c) < 64 * _words && static_cast<unsigned>(c) / 64 == word) ? (1ULL << (static_cast<unsigned>(c) % 64)) : 0; }
+  static constexpr unsigned long long _word(unsigned /*unused*/) noexcept { return 0; }
+  template <class... Args> static constexpr unsigned long long _word(unsigned word, errc c, Args... args) noexcept { return _bit(word, c) | _word(word, args...); }
+  constexpr errc_set(unsigned long long a, unsigned long long b, unsigned long long c, unsigned long long d) noexcept
+      : _bits{a, b, c, d}
+  {
+  }
+
+public:
+  //! Constructs the empty set
+  constexpr errc_set() noexcept
+      : _bits{0, 0, 0, 0}
+  {
+  }
+  //! Constructs a set of the values supplied
+  template <class... Args>
+  constexpr errc_set(errc c, Args... args) noexcept  // NOLINT
+      : _bits{_word(0, c, args...), _word(1, c, args...), _word(2, c, args...), _word(3, c, args...)}
+  {
+  }
+
+  //! True if there are no members
+  constexpr bool empty() const noexcept { return (_bits[0] | _bits[1] | _bits[2] | _bits[3]) == 0; }
+  //! True if `c` is a member
+  constexpr bool contains(errc c) const noexcept { return static_cast<unsigned>(c) < 64 * _words && ((_bits[static_cast<unsigned>(c) / 64] >> (static_cast<unsigned>(c) % 64)) & 1) != 0; }
+  //! Returns the union of two sets
+  constexpr errc_set operator|(const errc_set &o) const noexcept { return {_bits[0] | o._bits[0], _bits[1] | o._bits[1], _bits[2] | o._bits[2], _bits[3] | o._bits[3]}; }
+  //! Returns the intersection of two sets
+  constexpr errc_set operator&(const errc_set &o) const noexcept { return {_bits[0] & o._bits[0], _bits[1] & o._bits[1], _bits[2] & o._bits[2], _bits[3] & o._bits[3]}; }
+  //! True if both sets have the same members
+  constexpr bool operator==(const errc_set &o) const noexcept { return _bits[0] == o._bits[0] && _bits[1] == o._bits[1] && _bits[2] == o._bits[2] && _bits[3] == o._bits[3]; }
+  //! True if the sets have different members
+  constexpr bool operator!=(const errc_set &o) const noexcept { return !(*this == o); }
+};
+
+inline bool status_code<void>::in(const errc_set &s) const noexcept
+{
+  if(!_domain)
+  {
+    return false;
+  }
+  // Generic codes are their own generic code, so need no virtual call
+  if(_domain_untagged()->id() == generic_code_domain.id())
+  {
+    return s.contains(static_cast<const generic_code &>(*this).value());  // NOLINT
+  }
+  return s.contains(_domain_untagged()->_generic_code(*this).value());
+}
 
 /*************************************************************************************************************/
 
@@ -373,21 +498,32 @@ template <class T> inline bool status_code<void>::equivalent(const status_code<T
 {
   if(_domain && o._domain)
   {
-    if(_domain->_do_equivalent(*this, o))
+    const auto id1 = _domain_untagged()->id(), id2 = o._domain_untagged()->id();
+    if(id1 != id2)
+    {
+      bool reversed = false;
+      if(equivalence_function f = detail::equivalence_registry_find(id1, id2, reversed))
+      {
+        const status_code<void> &other = o;
+        return reversed ? f(other, *this) : f(*this, other);
+      }
+    }
+    if(_domain_untagged()->_do_equivalent(*this, o))
     {
       return true;
     }
-    if(o._domain->_do_equivalent(o, *this))
+    if(o._domain_untagged()->_do_equivalent(o, *this))
     {
       return true;
     }
-    generic_code c1 = o._domain->_generic_code(o);
-    if(c1.value() != errc::unknown && _domain->_do_equivalent(*this, c1))
+    // Domains may return an empty generic code if there is none
+    generic_code c1 = o._domain_untagged()->_generic_code(o);
+    if(!c1.empty() && c1.value() != errc::unknown && _domain_untagged()->_do_equivalent(*this, c1))
     {
       return true;
     }
-    generic_code c2 = _domain->_generic_code(*this);
-    if(c2.value() != errc::unknown && o._domain->_do_equivalent(o, c2))
+    generic_code c2 = _domain_untagged()->_generic_code(*this);
+    if(!c2.empty() && c2.value() != errc::unknown && o._domain_untagged()->_do_equivalent(o, c2))
     {
       return true;
     }
@@ -395,47 +531,100 @@ template <class T> inline bool status_code<void>::equivalent(const status_code<T
   // If we are both empty, we are equivalent, otherwise not equivalent
   return (!_domain && !o._domain);
 }
+namespace traits
+{
+  /*! Specialise to declare that equivalence between codes of two statically known domains
+  can be decided at compile time, without consulting either domain. Specialisations must
+  set `value` to true and provide:
+
+  `static constexpr bool equivalent(const status_code<DomainType1> &, const status_code<DomainType2> &) noexcept`
+
+  which must return exactly what `status_code<void>::equivalent()` would, including for
+  empty codes, if no function is registered for the two domains by `register_equivalence()`.
+  Comparisons of typed codes via `operator==` then compile down to an integer compare. For
+  codes of different domains, that is preceded at runtime by a check that no function is
+  registered for them, which if one is, decides instead. Where `__builtin_is_constant_evaluated()`
+  is unavailable, only comparisons of codes of the same domain are constant expressions.
+  */
+  template <class DomainType1, class DomainType2> struct static_equivalence
+  {
+    static constexpr bool value = false;
+  };
+  template <> struct static_equivalence<_generic_code_domain, _generic_code_domain>
+  {
+    static constexpr bool value = true;
+    static constexpr bool equivalent(const generic_code &a, const generic_code &b) noexcept { return (a.empty() || b.empty()) ? (a.empty() && b.empty()) : (a.value() == b.value()); }
+  };
+}  // namespace traits
+
+namespace detail
+{
+  // True if register_equivalence() may have replaced what equivalence between codes of the domains would be
+  template <class DomainType1, class DomainType2> inline bool equivalence_is_registered() noexcept
+  {
+    bool reversed = false;
+    return !std::is_same<DomainType1, DomainType2>::value && equivalence_registry_find(DomainType1::get().id(), DomainType2::get().id(), reversed) != nullptr;
+  }
+  template <class DomainType1, class DomainType2> constexpr inline bool is_equivalent(const status_code<DomainType1> &a, const status_code<DomainType2> &b, std::true_type /*unused*/) noexcept
+  {
+    // Nothing can have been registered during constant evaluation, nor ever for a single domain
+    return (std::is_same<DomainType1, DomainType2>::value
+#ifdef SYSTEM_ERROR2_HAVE_IS_CONSTANT_EVALUATED
+            || __builtin_is_constant_evaluated()
+#endif
+            || !equivalence_is_registered<DomainType1, DomainType2>()) ?
+           traits::static_equivalence<DomainType1, DomainType2>::equivalent(a, b) :
+           a.equivalent(b);
+  }
+  template <class DomainType1, class DomainType2> inline bool is_equivalent(const status_code<DomainType1> &a, const status_code<DomainType2> &b, std::false_type /*unused*/) noexcept { return a.equivalent(b); }
+  // Statically resolves equivalence if the domains say it can be, otherwise calls `equivalent()`
+  template <class DomainType1, class DomainType2> constexpr inline bool is_equivalent(const status_code<DomainType1> &a, const status_code<DomainType2> &b) noexcept
+  {
+    return is_equivalent(a, b, std::integral_constant<bool, traits::static_equivalence<DomainType1, DomainType2>::value>());
+  }
+}  // namespace detail
+
 //! True if the status code's are semantically equal via `equivalent()`.
-template <class DomainType1, class DomainType2> inline bool operator==(const status_code<DomainType1> &a, const status_code<DomainType2> &b) noexcept
+template <class DomainType1, class DomainType2> constexpr inline bool operator==(const status_code<DomainType1> &a, const status_code<DomainType2> &b) noexcept
 {
-  return a.equivalent(b);
+  return detail::is_equivalent(a, b);
 }
 //! True if the status code's are not semantically equal via `equivalent()`.
-template <class DomainType1, class DomainType2> inline bool operator!=(const status_code<DomainType1> &a, const status_code<DomainType2> &b) noexcept
+template <class DomainType1, class DomainType2> constexpr inline bool operator!=(const status_code<DomainType1> &a, const status_code<DomainType2> &b) noexcept
 {
-  return !a.equivalent(b);
+  return !detail::is_equivalent(a, b);
 }
 //! True if the status code's are semantically equal via `equivalent()` to `make_status_code(T)`.
 template <class DomainType1, class T,                                                                       //
           class MakeStatusCodeResult = typename detail::safe_get_make_status_code_result<const T &>::type,  // Safe ADL lookup of make_status_code(), returns void if not found
           typename std::enable_if<is_status_code<MakeStatusCodeResult>::value, bool>::type = true>          // ADL makes a status code
-inline bool operator==(const status_code<DomainType1> &a, const T &b)
+constexpr inline bool operator==(const status_code<DomainType1> &a, const T &b)
 {
-  return a.equivalent(make_status_code(b));
+  return detail::is_equivalent(a, make_status_code(b));
 }
 //! True if the status code's are semantically equal via `equivalent()` to `make_status_code(T)`.
 template <class T, class DomainType1,                                                                       //
           class MakeStatusCodeResult = typename detail::safe_get_make_status_code_result<const T &>::type,  // Safe ADL lookup of make_status_code(), returns void if not found
           typename std::enable_if<is_status_code<MakeStatusCodeResult>::value, bool>::type = true>          // ADL makes a status code
-inline bool operator==(const T &a, const status_code<DomainType1> &b)
+constexpr inline bool operator==(const T &a, const status_code<DomainType1> &b)
 {
-  return b.equivalent(make_status_code(a));
+  return detail::is_equivalent(b, make_status_code(a));
 }
 //! True if the status code's are not semantically equal via `equivalent()` to `make_status_code(T)`.
 template <class DomainType1, class T,                                                                       //
           class MakeStatusCodeResult = typename detail::safe_get_make_status_code_result<const T &>::type,  // Safe ADL lookup of make_status_code(), returns void if not found
           typename std::enable_if<is_status_code<MakeStatusCodeResult>::value, bool>::type = true>          // ADL makes a status code
-inline bool operator!=(const status_code<DomainType1> &a, const T &b)
+constexpr inline bool operator!=(const status_code<DomainType1> &a, const T &b)
 {
-  return !a.equivalent(make_status_code(b));
+  return !detail::is_equivalent(a, make_status_code(b));
 }
 //! True if the status code's are semantically equal via `equivalent()` to `make_status_code(T)`.
 template <class T, class DomainType1,                                                                       //
           class MakeStatusCodeResult = typename detail::safe_get_make_status_code_result<const T &>::type,  // Safe ADL lookup of make_status_code(), returns void if not found
           typename std::enable_if<is_status_code<MakeStatusCodeResult>::value, bool>::type = true>          // ADL makes a status code
-inline bool operator!=(const T &a, const status_code<DomainType1> &b)
+constexpr inline bool operator!=(const T &a, const status_code<DomainType1> &b)
 {
-  return !b.equivalent(make_status_code(a));
+  return !detail::is_equivalent(b, make_status_code(a));
 }
 
 SYSTEM_ERROR2_NAMESPACE_END
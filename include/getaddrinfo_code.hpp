@@ -43,12 +43,77 @@ using getaddrinfo_code = status_code<_getaddrinfo_code_domain>;
 //! A specialisation of `status_error` for the `getaddrinfo()` error code domain.
 using getaddrinfo_error = status_error<_getaddrinfo_code_domain>;
 
+namespace detail
+{
+  /* The untranslated messages for the getaddrinfo() codes, null terminated, in one contiguous blob, with
+  the offset and length of each. So few that they are searched linearly. A template so these are defined
+  once in the program, without needing C++17 inline variables.
+  */
+  template <class = void> struct getaddrinfo_code_messages
+  {
+    struct entry
+    {
+      int code;
+      unsigned short offset, length;
+    };
+    static constexpr char blob[] =  //
+    "Address family for hostname not supported\0"
+    "Temporary failure in name resolution\0"
+    "Bad value for ai_flags\0"
+    "Non-recoverable failure in name resolution\0"
+    "ai_family not supported\0"
+    "Memory allocation failure\0"
+    "No address associated with hostname\0"
+    "Name or service not known\0"
+    "Argument buffer overflow\0"
+    "Servname not supported for ai_socktype\0"
+    "ai_socktype not supported\0"
+    "System error\0";
+    static constexpr entry entries[] = {
+#ifdef EAI_ADDRFAMILY
+    {EAI_ADDRFAMILY, 0, 41},
+#endif
+    {EAI_AGAIN, 42, 36},
+    {EAI_BADFLAGS, 79, 22},
+    {EAI_FAIL, 102, 42},
+    {EAI_FAMILY, 145, 23},
+    {EAI_MEMORY, 169, 25},
+#ifdef EAI_NODATA
+    {EAI_NODATA, 195, 35},
+#endif
+    {EAI_NONAME, 231, 25},
+#ifdef EAI_OVERFLOW
+    {EAI_OVERFLOW, 257, 24},
+#endif
+    {EAI_SERVICE, 282, 38},
+    {EAI_SOCKTYPE, 321, 25},
+    {EAI_SYSTEM, 347, 12},
+    };
+  };
+  template <class T> constexpr char getaddrinfo_code_messages<T>::blob[];
+  template <class T> constexpr typename getaddrinfo_code_messages<T>::entry getaddrinfo_code_messages<T>::entries[];
+
+  //! The message for `code`, or a view of no string if it is not known.
+  inline status_code_domain::message_view_type getaddrinfo_code_message_view(int code) noexcept
+  {
+    using messages = getaddrinfo_code_messages<>;
+    for(const auto &e : messages::entries)
+    {
+      if(e.code == code)
+      {
+        return {messages::blob + e.offset, e.length};
+      }
+    }
+    return {};
+  }
+}  // namespace detail
+
 /*! The implementation of the domain for `getaddrinfo()` error codes, those returned by `getaddrinfo()`.
  */
 class _getaddrinfo_code_domain : public status_code_domain
 {
   template <class DomainType> friend class status_code;
-  template <class StatusCode> friend class detail::indirecting_domain;
+  template <class StatusCode, class Allocator> friend class detail::indirecting_domain;
   using _base = status_code_domain;
 
 public:
@@ -69,13 +134,15 @@ public:
 
   //! Constexpr singleton getter. Returns constexpr getaddrinfo_code_domain variable.
   static inline constexpr const _getaddrinfo_code_domain &get();
+  //! True if a code of this domain with value `v` is a failure, without need of a virtual function call.
+  static constexpr bool _failure_of(const value_type &v) noexcept { return v != 0; }
 
   virtual string_ref name() const noexcept override { return string_ref("getaddrinfo() domain"); }  // NOLINT
 protected:
   virtual bool _do_failure(const status_code<void> &code) const noexcept override  // NOLINT
   {
-    assert(code.domain() == *this);                                   // NOLINT
-    return static_cast<const getaddrinfo_code &>(code).value() != 0;  // NOLINT
+    assert(code.domain() == *this);                                           // NOLINT
+    return _failure_of(static_cast<const getaddrinfo_code &>(code).value());  // NOLINT
   }
   virtual bool _do_equivalent(const status_code<void> &code1, const status_code<void> &code2) const noexcept override  // NOLINT
   {
@@ -131,6 +198,30 @@ protected:
     const auto &c = static_cast<const getaddrinfo_code &>(code);  // NOLINT
     return string_ref(gai_strerror(c.value()));
   }
+  virtual size_t _do_format_message(const status_code<void> &code, char *buffer, size_t bytes) const noexcept override  // NOLINT
+  {
+    assert(code.domain() == *this);                               // NOLINT
+    const auto &c = static_cast<const getaddrinfo_code &>(code);  // NOLINT
+    // gai_strerror() may consult the locale, which can lock, so use the untranslated text
+    detail::message_writer w(buffer, bytes);
+    const auto view = detail::getaddrinfo_code_message_view(c.value());
+    if(view.data() != nullptr)
+    {
+      w.append(view.data(), view.size());
+    }
+    else
+    {
+      w.append("Unknown error ", 14);
+      w.append(static_cast<long long>(c.value()));
+    }
+    return w.finish();
+  }
+  virtual message_view_type _do_message_view(const status_code<void> &code) const noexcept override  // NOLINT
+  {
+    assert(code.domain() == *this);                               // NOLINT
+    const auto &c = static_cast<const getaddrinfo_code &>(code);  // NOLINT
+    return detail::getaddrinfo_code_message_view(c.value());
+  }
 #if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(STANDARDESE_IS_IN_THE_HOUSE)
   SYSTEM_ERROR2_NORETURN virtual void _do_throw_exception(const status_code<void> &code) const override  // NOLINT
   {
@@ -142,6 +233,7 @@ protected:
 };
 //! A constexpr source variable for the `getaddrinfo()` code domain, which is that of `getaddrinfo()`. Returned by `_getaddrinfo_code_domain::get()`.
 constexpr _getaddrinfo_code_domain getaddrinfo_code_domain;
+SYSTEM_ERROR2_REGISTER_DOMAIN(getaddrinfo_code_domain);
 inline constexpr const _getaddrinfo_code_domain &_getaddrinfo_code_domain::get()
 {
   return getaddrinfo_code_domain;
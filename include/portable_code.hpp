@@ -0,0 +1,116 @@
+/* A status code which can be shared between processes
+(C) 2026 agent <agent@local> (3 commits)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef SYSTEM_ERROR2_PORTABLE_CODE_HPP
+#define SYSTEM_ERROR2_PORTABLE_CODE_HPP
+
+#include "provenance.hpp"
+
+SYSTEM_ERROR2_NAMESPACE_BEGIN
+
+/*! A status code which refers to its domain by unique id rather than by address, so it means the same
+thing in any process, and can be placed in shared memory or in files mapped by other processes. It is
+two words, trivially copyable, and its all bits zero representation is empty.
+
+Its domain is looked up with `find_domain()` only when needed, so must be registered in any process which
+converts it back into a `system_code`. The processes must agree on the size of `intptr_t`.
+
+Codes whose value is not an integer, or an enum, cannot be made portable, as their value is only meaningful
+within the process. For erased codes, this cannot be checked: do not convert codes made by `make_status_code_ptr()`.
+Codes made by `with_provenance()` are converted as the code they wrap.
+*/
+class portable_code
+{
+public:
+  //! The type of the unique id of the domain.
+  using unique_id_type = status_code_domain::unique_id_type;
+  //! The type of the value.
+  using value_type = intptr_t;
+
+private:
+  unique_id_type _id{0};
+  value_type _value{0};
+
+  static portable_code _from(const status_code<void> &code, value_type value) noexcept
+  {
+    if(code.empty())
+    {
+      return {};
+    }
+    if(code.domain() == detail::provenance_domain::get())
+    {
+      return portable_code(static_cast<const status_code<detail::provenance_domain> &>(code).value()->sc);  // NOLINT
+    }
+    return {code.domain().id(), value};
+  }
+
+public:
+  //! Default construction to empty
+  portable_code() = default;
+  //! Explicit construction from a domain id and a value of that domain.
+  constexpr portable_code(unique_id_type id, value_type value) noexcept
+      : _id(id)
+      , _value(value)
+  {
+  }
+  //! Explicit construction from any status code whose value is an integer or enum which fits into a `value_type`.
+  template <class DomainType> explicit portable_code(const status_code<DomainType> &code) noexcept
+  {
+    using code_value_type = typename status_code<DomainType>::value_type;
+    static_assert(std::is_integral<code_value_type>::value || std::is_enum<code_value_type>::value, "Only status codes with integer or enum values can be made portable");
+    static_assert(detail::type_erasure_is_safe<value_type, code_value_type>::value, "Only status codes whose values fit into an intptr_t can be made portable");
+    *this = _from(code, detail::erasure_cast<value_type>(code.value()));
+  }
+
+  //! True if the code is empty
+  constexpr bool empty() const noexcept { return _id == 0; }
+  //! The unique id of the domain.
+  constexpr unique_id_type id() const noexcept { return _id; }
+  //! The value.
+  constexpr value_type value() const noexcept { return _value; }
+  //! The domain, or null if empty or if its domain is not registered in this process.
+  const status_code_domain *domain() const noexcept { return empty() ? nullptr : find_domain(_id); }
+
+  /*! Returns the code as a `system_code`, which is empty if this is empty, or if its domain is not
+  registered in this process as one whose value is an integer or enum. A portable code may come from
+  another process, so one naming a domain whose value is a pointer is never rebuilt. Costs one lookup
+  in the domain registry.
+  */
+  system_code to_system_code() const noexcept
+  {
+    const status_code_domain *d = empty() ? nullptr : detail::find_integral_domain(_id);
+    return (d == nullptr) ? system_code() : system_code(d, _value);
+  }
+
+  //! True if the id and value are identical. This is exact comparison, not semantic equivalence.
+  constexpr bool operator==(const portable_code &o) const noexcept { return _id == o._id && _value == o._value; }
+  //! False if the id and value are identical.
+  constexpr bool operator!=(const portable_code &o) const noexcept { return _id != o._id || _value != o._value; }
+};
+static_assert(sizeof(portable_code) == sizeof(status_code_domain::unique_id_type) + sizeof(intptr_t), "portable_code is not two words!");
+static_assert(std::is_trivially_copyable<portable_code>::value, "portable_code is not trivially copyable!");
+
+SYSTEM_ERROR2_NAMESPACE_END
+
+#endif
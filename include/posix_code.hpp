@@ -33,6 +33,16 @@ http://www.boost.org/LICENSE_1_0.txt)
 
 #include <cstring>  // for strchr and strerror_r
 
+/*! \def SYSTEM_ERROR2_POSIX_MESSAGE_TABLE
+If defined, `posix_code::message()` for errno values below `SYSTEM_ERROR2_POSIX_MESSAGE_TABLE_SIZE`
+returns a string ref into an immutable table built thread safely on first use, so it never
+allocates. Messages are captured in whatever locale is current at first use. `format_message_to()`
+then writes the same text, otherwise it writes the untranslated `errc` text, which can differ.
+*/
+#if defined(SYSTEM_ERROR2_POSIX_MESSAGE_TABLE) && !defined(SYSTEM_ERROR2_POSIX_MESSAGE_TABLE_SIZE)
+#define SYSTEM_ERROR2_POSIX_MESSAGE_TABLE_SIZE 256
+#endif
+
 SYSTEM_ERROR2_NAMESPACE_BEGIN
 
 class _posix_code_domain;
@@ -46,32 +56,102 @@ using posix_error = status_error<_posix_code_domain>;
 class _posix_code_domain : public status_code_domain
 {
   template <class DomainType> friend class status_code;
-  template <class StatusCode> friend class detail::indirecting_domain;
+  template <class StatusCode, class Allocator> friend class detail::indirecting_domain;
   using _base = status_code_domain;
 
-  static _base::string_ref _make_string_ref(int c) noexcept
+  // Writes the system's message for `c` into `buffer`, returning its length
+  static size_t _strerror(int c, char (&buffer)[1024]) noexcept
   {
-    char buffer[1024] = "";
+    buffer[0] = 0;
 #ifdef _WIN32
     strerror_s(buffer, sizeof(buffer), c);
 #elif defined(__gnu_linux__) && !defined(__ANDROID__)  // handle glibc's weird strerror_r()
     char *s = strerror_r(c, buffer, sizeof(buffer));   // NOLINT
-    if(s != nullptr)
+    if(s != nullptr && s != buffer)
     {
-      strncpy(buffer, s, sizeof(buffer));  // NOLINT
-      buffer[1023] = 0;
+      size_t length = strlen(s);  // NOLINT
+      if(length >= sizeof(buffer))
+      {
+        length = sizeof(buffer) - 1;
+      }
+      memcpy(buffer, s, length);  // NOLINT
+      buffer[length] = 0;
     }
 #else
     strerror_r(c, buffer, sizeof(buffer));
 #endif
-    size_t length = strlen(buffer);  // NOLINT
-    auto *p = static_cast<char *>(malloc(length + 1));  // NOLINT
-    if(p == nullptr)
+    return strlen(buffer);  // NOLINT
+  }
+
+#ifdef SYSTEM_ERROR2_POSIX_MESSAGE_TABLE
+  /* An immutable table of the messages for errno values `[0, SYSTEM_ERROR2_POSIX_MESSAGE_TABLE_SIZE)`,
+  built once on first use. All the message text lives in a single allocation which is never
+  freed, so string refs into it remain valid for the whole life of the process, including
+  during static deinitialisation.
+  */
+  struct _message_table
+  {
+    struct entry
+    {
+      unsigned offset, length;
+    };
+    const char *text{nullptr};
+    entry entries[SYSTEM_ERROR2_POSIX_MESSAGE_TABLE_SIZE]{};
+
+    _message_table() noexcept
     {
-      return _base::string_ref("failed to get message from system");
+      char buffer[1024];
+      size_t total = 0;
+      for(int c = 0; c < SYSTEM_ERROR2_POSIX_MESSAGE_TABLE_SIZE; c++)
+      {
+        entries[c].length = static_cast<unsigned>(_strerror(c, buffer));
+        entries[c].offset = static_cast<unsigned>(total);
+        total += entries[c].length + 1;
+      }
+      auto *p = static_cast<char *>(malloc(total));  // NOLINT
+      if(p == nullptr)
+      {
+        return;
+      }
+      for(int c = 0; c < SYSTEM_ERROR2_POSIX_MESSAGE_TABLE_SIZE; c++)
+      {
+        // Never overrun the space measured by the first pass
+        size_t length = _strerror(c, buffer);
+        if(length > entries[c].length)
+        {
+          length = entries[c].length;
+        }
+        memcpy(p + entries[c].offset, buffer, length);  // NOLINT
+        p[entries[c].offset + length] = 0;
+        entries[c].length = static_cast<unsigned>(length);
+      }
+      text = p;
     }
-    memcpy(p, buffer, length + 1);  // NOLINT
-    return _base::atomic_refcounted_string_ref(p, length);
+  };
+  static const _message_table &_messages() noexcept
+  {
+    static const _message_table v;
+    return v;
+  }
+#endif
+
+  static _base::string_ref _make_string_ref(int c) noexcept
+  {
+#ifdef SYSTEM_ERROR2_POSIX_MESSAGE_TABLE
+    if(c >= 0 && c < SYSTEM_ERROR2_POSIX_MESSAGE_TABLE_SIZE)
+    {
+      const auto &table = _messages();
+      if(table.text != nullptr)
+      {
+        const auto &e = table.entries[c];
+        // No thunk, so copies and destruction of the string ref are trivial
+        return _base::string_ref(table.text + e.offset, e.length, nullptr, nullptr, nullptr, nullptr);
+      }
+    }
+#endif
+    char buffer[1024];
+    size_t length = _strerror(c, buffer);
+    return _base::atomic_refcounted_block_string_ref(buffer, length);
   }
 
 public:
@@ -80,7 +160,7 @@ public:
   using _base::string_ref;
 
   //! Default constructor
-  constexpr explicit _posix_code_domain(typename _base::unique_id_type id = 0xa59a56fe5f310933) noexcept : _base(id) {}
+  constexpr explicit _posix_code_domain(typename _base::unique_id_type id = 0xa59a56fe5f310933) noexcept : _base(id, id == 0xa59a56fe5f310933) {}
   _posix_code_domain(const _posix_code_domain &) = default;
   _posix_code_domain(_posix_code_domain &&) = default;
   _posix_code_domain &operator=(const _posix_code_domain &) = default;
@@ -89,13 +169,15 @@ public:
 
   //! Constexpr singleton getter. Returns constexpr posix_code_domain variable.
   static inline constexpr const _posix_code_domain &get();
+  //! True if a code of this domain with value `v` is a failure, without need of a virtual function call.
+  static constexpr bool _failure_of(const value_type &v) noexcept { return v != 0; }
 
   virtual string_ref name() const noexcept override { return string_ref("posix domain"); }  // NOLINT
 protected:
   virtual bool _do_failure(const status_code<void> &code) const noexcept override  // NOLINT
   {
     assert(code.domain() == *this);  // NOLINT
-    return static_cast<const posix_code &>(code).value() != 0;  // NOLINT
+    return _failure_of(static_cast<const posix_code &>(code).value());  // NOLINT
   }
   virtual bool _do_equivalent(const status_code<void> &code1, const status_code<void> &code2) const noexcept override  // NOLINT
   {
@@ -128,6 +210,53 @@ protected:
     const auto &c = static_cast<const posix_code &>(code);  // NOLINT
     return _make_string_ref(c.value());
   }
+  virtual size_t _do_format_message(const status_code<void> &code, char *buffer, size_t bytes) const noexcept override  // NOLINT
+  {
+    assert(code.domain() == *this);  // NOLINT
+    const auto &c = static_cast<const posix_code &>(code);  // NOLINT
+    detail::message_writer w(buffer, bytes);
+#ifdef SYSTEM_ERROR2_POSIX_MESSAGE_TABLE
+    // The same text as message() returns
+    const auto view = _do_message_view(code);
+    if(view.data() != nullptr)
+    {
+      w.append(view.data(), view.size());
+      return w.finish();
+    }
+#endif
+    /* strerror_r() may consult the locale, which can lock, so use the untranslated text. This can
+    differ from what message() returns, which is the system's possibly localised text.
+    */
+    if(detail::generic_code_message_lookup(static_cast<errc>(c.value())) != 0)
+    {
+      const auto view = detail::generic_code_message_view(static_cast<errc>(c.value()));
+      w.append(view.data(), view.size());
+    }
+    else
+    {
+      w.append("Unknown error ", 14);
+      w.append(static_cast<long long>(c.value()));
+    }
+    return w.finish();
+  }
+#ifdef SYSTEM_ERROR2_POSIX_MESSAGE_TABLE
+  // The message table is immutable and never freed, so can be viewed
+  virtual message_view_type _do_message_view(const status_code<void> &code) const noexcept override  // NOLINT
+  {
+    assert(code.domain() == *this);  // NOLINT
+    const auto &c = static_cast<const posix_code &>(code);  // NOLINT
+    if(c.value() >= 0 && c.value() < SYSTEM_ERROR2_POSIX_MESSAGE_TABLE_SIZE)
+    {
+      const auto &table = _messages();
+      if(table.text != nullptr)
+      {
+        const auto &e = table.entries[c.value()];
+        return {table.text + e.offset, e.length};
+      }
+    }
+    return {};
+  }
+#endif
 #if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(STANDARDESE_IS_IN_THE_HOUSE)
   SYSTEM_ERROR2_NORETURN virtual void _do_throw_exception(const status_code<void> &code) const override  // NOLINT
   {
@@ -139,11 +268,32 @@ protected:
 };
 //! A constexpr source variable for the POSIX code domain, which is that of `errno`. Returned by `_posix_code_domain::get()`.
 constexpr _posix_code_domain posix_code_domain;
+SYSTEM_ERROR2_REGISTER_DOMAIN(posix_code_domain);
 inline constexpr const _posix_code_domain &_posix_code_domain::get()
 {
   return posix_code_domain;
 }
 
+namespace traits
+{
+  template <> struct static_equivalence<_posix_code_domain, _posix_code_domain>
+  {
+    static constexpr bool value = true;
+    static constexpr bool equivalent(const posix_code &a, const posix_code &b) noexcept { return (a.empty() || b.empty()) ? (a.empty() && b.empty()) : (a.value() == b.value()); }
+  };
+  // POSIX codes map onto generic codes by value
+  template <> struct static_equivalence<_posix_code_domain, _generic_code_domain>
+  {
+    static constexpr bool value = true;
+    static constexpr bool equivalent(const posix_code &a, const generic_code &b) noexcept { return (a.empty() || b.empty()) ? (a.empty() && b.empty()) : (a.value() == static_cast<int>(b.value())); }
+  };
+  template <> struct static_equivalence<_generic_code_domain, _posix_code_domain>
+  {
+    static constexpr bool value = true;
+    static constexpr bool equivalent(const generic_code &a, const posix_code &b) noexcept { return static_equivalence<_posix_code_domain, _generic_code_domain>::equivalent(b, a); }
+  };
+}  // namespace traits
+
 SYSTEM_ERROR2_NAMESPACE_END
 
 #endif
@@ -0,0 +1,300 @@
+/* Capture where failures were created
+(C) 2026 agent <agent@local> (6 commits)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef SYSTEM_ERROR2_PROVENANCE_HPP
+#define SYSTEM_ERROR2_PROVENANCE_HPP
+
+#include "error.hpp"
+
+#include <cstdint>
+
+#ifndef SYSTEM_ERROR2_PROVENANCE_FRAMES
+//! The maximum number of return addresses captured in a sampled backtrace.
+#define SYSTEM_ERROR2_PROVENANCE_FRAMES 16
+#endif
+#ifndef SYSTEM_ERROR2_PROVENANCE_SAMPLE_RATE
+//! The initial value of `provenance_sample_rate()`.
+#define SYSTEM_ERROR2_PROVENANCE_SAMPLE_RATE 64
+#endif
+#ifndef SYSTEM_ERROR2_PROVENANCE_BACKTRACE
+/*! Define to 1 to walk frame pointers for sampled backtraces. Only safe if the whole
+program is compiled with frame pointers (`-fno-omit-frame-pointer`), as otherwise what
+look like frame pointers may point anywhere. Only GCC and clang on x64 and AArch64 are
+supported; elsewhere backtraces are always empty.
+*/
+#define SYSTEM_ERROR2_PROVENANCE_BACKTRACE 0
+#endif
+
+#if(defined(__GNUC__) && __GNUC__ >= 5) || (defined(__clang__) && __clang_major__ >= 9) || (defined(_MSC_VER) && _MSC_VER >= 1926)
+//! Defined to 1 if `provenance_location::current()` can supply the location of its caller.
+#define SYSTEM_ERROR2_HAVE_SOURCE_LOCATION 1
+#endif
+
+SYSTEM_ERROR2_NAMESPACE_BEGIN
+
+//! A source location, filled in at the call site by `current()` where the compiler supports it.
+struct provenance_location
+{
+  const char *file;
+  const char *function;
+  unsigned line;
+
+#ifdef SYSTEM_ERROR2_HAVE_SOURCE_LOCATION
+  //! The location of the caller
+  static constexpr provenance_location current(const char *file = __builtin_FILE(), const char *function = __builtin_FUNCTION(), unsigned line = __builtin_LINE()) noexcept { return {file, function, line}; }
+#else
+  //! This compiler cannot supply the location of the caller, so this is empty
+  static constexpr provenance_location current() noexcept { return {nullptr, nullptr, 0}; }
+#endif
+};
+
+//! Where and when a failure was created, as captured by `with_provenance()`.
+struct status_code_provenance
+{
+  //! The location which called `with_provenance()`
+  provenance_location location;
+  //! The value of `detail::read_timestamp_counter()` when captured
+  unsigned long long timestamp;
+  //! The number of return addresses in `backtrace`, which is zero unless this failure was sampled
+  unsigned frames;
+  //! The return addresses of the calling frames, innermost first
+  void *backtrace[SYSTEM_ERROR2_PROVENANCE_FRAMES];
+};
+
+namespace detail
+{
+  // A template so the rate is constant initialised without a guard
+  template <class = void> struct provenance_config
+  {
+    static std::atomic<unsigned> sample_rate;
+  };
+  template <class T> std::atomic<unsigned> provenance_config<T>::sample_rate{SYSTEM_ERROR2_PROVENANCE_SAMPLE_RATE};
+
+  // True one in every `provenance_sample_rate()` calls on each thread
+  inline bool provenance_sample() noexcept
+  {
+    static thread_local unsigned count;
+    const unsigned rate = provenance_config<>::sample_rate.load(std::memory_order_relaxed);
+    if(rate == 0 || ++count < rate)
+    {
+      return false;
+    }
+    count = 0;
+    return true;
+  }
+
+#if SYSTEM_ERROR2_PROVENANCE_BACKTRACE && (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__aarch64__))
+  __attribute__((noinline)) inline unsigned provenance_backtrace(void **frames, unsigned max) noexcept
+  {
+    // On both x64 and AArch64, a frame pointer points at the caller's frame pointer, followed by the return address
+    auto *fp = static_cast<void **>(__builtin_frame_address(0));
+    unsigned n = 0;
+    while(n < max && fp != nullptr && fp[1] != nullptr)
+    {
+      frames[n++] = fp[1];
+      auto *next = static_cast<void **>(*fp);
+      // Stacks grow downwards, so a plausible caller's frame is a little above this one
+      if(next <= fp || reinterpret_cast<uintptr_t>(next) - reinterpret_cast<uintptr_t>(fp) > (1U << 20U) || (reinterpret_cast<uintptr_t>(next) & (sizeof(void *) - 1)) != 0)
+      {
+        break;
+      }
+      fp = next;
+    }
+    return n;
+  }
+#else
+  inline unsigned provenance_backtrace(void ** /*unused*/, unsigned /*unused*/) noexcept { return 0; }
+#endif
+
+  /* Wraps a `system_code` along with its provenance. Everything except copy and
+  destroy is forwarded to the wrapped code's domain at runtime, so wrapped codes
+  compare, print and throw exactly as the code they wrap. The payload is
+  reference counted, so erased copies share it.
+  */
+  class provenance_domain : public status_code_domain
+  {
+    template <class DomainType> friend class status_code;
+    using _base = status_code_domain;
+
+  public:
+    struct payload_type
+    {
+      system_code sc;
+      status_code_provenance provenance;
+      mutable std::atomic<size_t> count;
+    };
+    using value_type = payload_type *;
+    using _base::string_ref;
+
+    constexpr provenance_domain() noexcept
+        : _base(0x8f3b2c61d94a07e5)
+    {
+    }
+    provenance_domain(const provenance_domain &) = default;
+    provenance_domain(provenance_domain &&) = default;  // NOLINT
+    provenance_domain &operator=(const provenance_domain &) = default;
+    provenance_domain &operator=(provenance_domain &&) = default;  // NOLINT
+    ~provenance_domain() = default;
+
+    static inline constexpr const provenance_domain &get();
+
+    virtual string_ref name() const noexcept override { return string_ref("status code with provenance"); }  // NOLINT
+
+    // The side table of payloads, which caches freed payloads per thread
+    using _pool = status_code_ptr_pool<sizeof(payload_type), alignof(payload_type)>;
+
+  protected:
+    using _mycode = status_code<provenance_domain>;
+
+    static const status_code<void> &_unwrap(const status_code<void> &code) noexcept
+    {
+      if(code.domain() == get())
+      {
+        return static_cast<const _mycode &>(code).value()->sc;  // NOLINT
+      }
+      return code;
+    }
+    virtual bool _do_failure(const status_code<void> &code) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      return c.value()->sc.failure();
+    }
+    virtual bool _do_equivalent(const status_code<void> &code1, const status_code<void> &code2) const noexcept override  // NOLINT
+    {
+      assert(code1.domain() == *this);
+      const auto &c1 = static_cast<const _mycode &>(code1);  // NOLINT
+      const system_code &sc = c1.value()->sc;
+      // Unwrap both sides, else two codes with provenance would never be equivalent
+      return !sc.empty() && sc.domain()._do_equivalent(sc, _unwrap(code2));
+    }
+    virtual generic_code _generic_code(const status_code<void> &code) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      const system_code &sc = c.value()->sc;
+      return sc.empty() ? generic_code() : sc.domain()._generic_code(sc);
+    }
+    virtual string_ref _do_message(const status_code<void> &code) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      return c.value()->sc.message();
+    }
+    virtual size_t _do_format_message(const status_code<void> &code, char *buffer, size_t bytes) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      return c.value()->sc.format_message_to(buffer, bytes);
+    }
+    virtual message_view_type _do_message_view(const status_code<void> &code) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      return c.value()->sc.message_view();
+    }
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(STANDARDESE_IS_IN_THE_HOUSE)
+    SYSTEM_ERROR2_NORETURN virtual void _do_throw_exception(const status_code<void> &code) const override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      c.value()->sc.throw_exception();
+    }
+#endif
+    virtual void _do_erased_copy(status_code<void> &dst, const status_code<void> &src, size_t /*unused*/) const override  // NOLINT
+    {
+      // Note that dst will not have its domain set
+      assert(src.domain() == *this);
+      auto &d = static_cast<_mycode &>(dst);              // NOLINT
+      const auto &s = static_cast<const _mycode &>(src);  // NOLINT
+      s.value()->count.fetch_add(1, std::memory_order_relaxed);
+      new(&d) _mycode(in_place, s.value());
+    }
+    virtual void _do_erased_destroy(status_code<void> &code, size_t /*unused*/) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      auto &c = static_cast<_mycode &>(code);  // NOLINT
+      payload_type *p = c.value();
+      if(p->count.fetch_sub(1, std::memory_order_release) == 1)
+      {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        p->~payload_type();
+        _pool::deallocate(p);
+      }
+    }
+  };
+  constexpr provenance_domain _provenance_domain{};
+  SYSTEM_ERROR2_REGISTER_DOMAIN(_provenance_domain);
+  inline constexpr const provenance_domain &provenance_domain::get() { return _provenance_domain; }
+}  // namespace detail
+
+//! Returns how many failures, per thread, `with_provenance()` captures for each one with a backtrace. Zero means never.
+inline unsigned provenance_sample_rate() noexcept { return detail::provenance_config<>::sample_rate.load(std::memory_order_relaxed); }
+//! Sets `provenance_sample_rate()`, which may be done at any time from any thread.
+inline void set_provenance_sample_rate(unsigned rate) noexcept { detail::provenance_config<>::sample_rate.store(rate, std::memory_order_relaxed); }
+
+/*! Returns a `system_code` which wraps the failure `v` along with the location of the caller,
+a timestamp, and, one in every `provenance_sample_rate()` times, a backtrace. The result behaves
+exactly as `v` would in comparisons, messages and exceptions, and is still two words in size;
+the provenance lives in a side table referenced by it, retrievable by `get_provenance()`.
+
+Codes which do not need provenance are unaffected by this facility and never allocate. The
+side table caches freed entries per thread, so capturing in steady state does not call the free
+store either. If the side table cannot be extended, `v` is returned without provenance.
+*/
+template <class T, typename std::enable_if<std::is_constructible<system_code, T>::value, bool>::type = true>  //
+inline system_code with_provenance(T &&v, provenance_location location = provenance_location::current()) noexcept(std::is_nothrow_constructible<system_code, T>::value)
+{
+  system_code sc(static_cast<T &&>(v));
+  if(sc.empty() || !sc.failure())
+  {
+    return sc;
+  }
+  using domain_type = detail::provenance_domain;
+  void *mem = domain_type::_pool::allocate();
+  if(mem == nullptr)
+  {
+    return sc;
+  }
+  auto *p = new(mem) domain_type::payload_type{static_cast<system_code &&>(sc), {location, detail::read_timestamp_counter(), 0, {}}, {1}};
+  if(detail::provenance_sample())
+  {
+    p->provenance.frames = detail::provenance_backtrace(p->provenance.backtrace, SYSTEM_ERROR2_PROVENANCE_FRAMES);
+  }
+  return status_code<domain_type>(in_place, p);
+}
+
+//! If `v` was returned by `with_provenance()`, or is a copy of one, returns its provenance. Otherwise returns null.
+template <class U> inline const status_code_provenance *get_provenance(const status_code<erased<U>> &v) noexcept
+{
+  if(v.empty() || v.domain() != detail::provenance_domain::get())
+  {
+    return nullptr;
+  }
+  return &detail::erasure_cast<const detail::provenance_domain::payload_type *>(v.value())->provenance;
+}
+
+SYSTEM_ERROR2_NAMESPACE_END
+
+#endif
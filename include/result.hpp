@@ -1,4 +1,4 @@
-/* A partial result based on std::variant and proposed std::error
+/* A partial result based on proposed std::error
 (C) 2020 Niall Douglas <http://www.nedproductions.biz/> (11 commits)
 File Created: Jan 2020
 
@@ -30,7 +30,10 @@ Distributed under the Boost Software License, Version 1.0.
 #if __has_include(<variant>)
 
 #include <exception>
-#include <variant>
+#include <cstring>  // for memcpy
+#include <new>
+#include <type_traits>
+#include <utility>
 
 SYSTEM_ERROR2_NAMESPACE_BEGIN
 
@@ -62,17 +65,173 @@ namespace detail
   {
   };
   template <class T> using devoid = std::conditional_t<std::is_void_v<T>, void_, T>;
+
+  // The address of this marks a result as valued. It can never be a domain pointer.
+  inline constexpr char result_valued_marker{};
+
+  /* The storage of a result. The value shares its first pointer with the domain
+  pointer of the error, which is never the address of `result_valued_marker`, so the
+  value is marked by setting that pointer to that address. We cannot use null as
+  the marker, as an error which has been moved from has a null domain pointer.
+
+  As `error` is not standard layout, reading `_value._marker` whilst `_error` is
+  the active member would be undefined behaviour. So at runtime that pointer is
+  read from the bytes of the storage, which is defined whichever member is active.
+  */
+  template <class T> struct result_storage
+  {
+    using value_type = devoid<T>;
+    using error_type = SYSTEM_ERROR2_NAMESPACE::error;
+
+    struct _value_storage
+    {
+      const void *_marker;
+      value_type _v;
+
+      template <class... Args>
+      constexpr explicit _value_storage(std::in_place_t /*unused*/, Args &&... args) noexcept(std::is_nothrow_constructible_v<value_type, Args...>)
+          : _marker(&result_valued_marker)
+          , _v(static_cast<Args &&>(args)...)
+      {
+      }
+    };
+    union {
+      error_type _error;
+      _value_storage _value;
+    };
+
+    template <class... Args>
+    constexpr explicit result_storage(std::in_place_index_t<1> /*unused*/, Args &&... args) noexcept(std::is_nothrow_constructible_v<value_type, Args...>)
+        : _value(std::in_place, static_cast<Args &&>(args)...)
+    {
+    }
+    template <class... Args>
+    constexpr explicit result_storage(std::in_place_index_t<0> /*unused*/, Args &&... args) noexcept(std::is_nothrow_constructible_v<error_type, Args...>)
+        : _error(static_cast<Args &&>(args)...)
+    {
+    }
+    result_storage(result_storage &&o) noexcept(std::is_nothrow_move_constructible_v<value_type>)
+    {
+      if(o._has_value())
+      {
+        new(&_value) _value_storage(std::in_place, static_cast<value_type &&>(o._value._v));
+      }
+      else
+      {
+        new(&_error) error_type(static_cast<error_type &&>(o._error));
+      }
+    }
+    result_storage &operator=(result_storage &&o) noexcept(std::is_nothrow_move_constructible_v<value_type> &&std::is_nothrow_move_assignable_v<value_type>)
+    {
+      // Else an errored result would destroy its error, then move from it
+      if(this == &o)
+      {
+        return *this;
+      }
+      if(o._has_value())
+      {
+        if(_has_value())
+        {
+          _value._v = static_cast<value_type &&>(o._value._v);
+          return *this;
+        }
+        if constexpr(std::is_nothrow_move_constructible_v<value_type>)
+        {
+          _error.~error_type();
+          new(&_value) _value_storage(std::in_place, static_cast<value_type &&>(o._value._v));
+        }
+        else
+        {
+          // Keep our error until the value is constructed, so we are never left empty
+          error_type e(static_cast<error_type &&>(_error));
+          _error.~error_type();
+#ifdef __cpp_exceptions
+          try
+          {
+            new(&_value) _value_storage(std::in_place, static_cast<value_type &&>(o._value._v));
+          }
+          catch(...)
+          {
+            new(&_error) error_type(static_cast<error_type &&>(e));
+            throw;
+          }
+#else
+          new(&_value) _value_storage(std::in_place, static_cast<value_type &&>(o._value._v));
+#endif
+        }
+        return *this;
+      }
+      _destroy();
+      new(&_error) error_type(static_cast<error_type &&>(o._error));
+      return *this;
+    }
+    SYSTEM_ERROR2_CONSTEXPR20 ~result_storage() { _destroy(); }
+
+    constexpr bool _has_value() const noexcept
+    {
+#ifdef __cpp_lib_is_constant_evaluated
+      // Constant evaluation diagnoses reading an inactive member, so an errored result can never be wrongly read as valued
+      if(std::is_constant_evaluated())
+      {
+        return _value._marker == &result_valued_marker;
+      }
+#endif
+      const void *first;
+      memcpy(&first, static_cast<const void *>(this), sizeof(first));  // NOLINT
+      return first == &result_valued_marker;
+    }
+    SYSTEM_ERROR2_CONSTEXPR20 void _destroy() noexcept
+    {
+      if(_has_value())
+      {
+        _value.~_value_storage();
+      }
+      else
+      {
+        _error.~error_type();
+      }
+    }
+  };
+
+  // Empty bases which delete the move operations of result when the value type lacks them
+  template <bool Construct, bool Assign> struct result_enable_move
+  {
+  };
+  template <> struct result_enable_move<true, false>
+  {
+    result_enable_move() = default;
+    result_enable_move(const result_enable_move &) = default;
+    result_enable_move(result_enable_move &&) = default;
+    result_enable_move &operator=(const result_enable_move &) = default;
+    result_enable_move &operator=(result_enable_move &&) = delete;
+    ~result_enable_move() = default;
+  };
+  template <bool Assign> struct result_enable_move<false, Assign>
+  {
+    result_enable_move() = default;
+    result_enable_move(const result_enable_move &) = default;
+    result_enable_move(result_enable_move &&) = delete;
+    result_enable_move &operator=(const result_enable_move &) = default;
+    result_enable_move &operator=(result_enable_move &&) = delete;
+    ~result_enable_move() = default;
+  };
 }  // namespace detail
 
 /*! \class result
-\brief A imperfect `result<T>` type with its error type hardcoded to `error`, only available on C++ 17 or later.
+\brief A `result<T>` type with its error type hardcoded to `error`, only available on C++ 17 or later.
+
+There is no separate discriminant. As `error` is never empty, its domain pointer
+is never the address of an internal marker object, so a valued result stores that
+address in the same place instead. Thus `sizeof(result<T>) == sizeof(error)` for
+any `T` no bigger than `error::value_type`. There is no valueless state either: if
+move assigning a value over an error throws, the error is retained.
 
-Note that the proper `result<T>` type does not have the possibility of
-valueless by exception state. This implementation is therefore imperfect.
+A `result<T>` is move bitcopying if `T` is.
 */
-template <class T> class result : protected std::variant<SYSTEM_ERROR2_NAMESPACE::error, detail::devoid<T>>
+template <class T> class result : protected detail::result_storage<T>, private detail::result_enable_move<std::is_move_constructible_v<detail::devoid<T>>, std::is_move_constructible_v<detail::devoid<T>> && std::is_move_assignable_v<detail::devoid<T>>>
 {
-  using _base = std::variant<SYSTEM_ERROR2_NAMESPACE::error, detail::devoid<T>>;
+  template <class U> friend class result;
+  using _base = detail::result_storage<T>;
   static_assert(!std::is_reference_v<T>, "Type cannot be a reference");
   static_assert(!std::is_array_v<T>, "Type cannot be an array");
   static_assert(!std::is_same_v<T, SYSTEM_ERROR2_NAMESPACE::error>, "Type cannot be a std::error");
@@ -107,12 +266,12 @@ public:
 protected:
   constexpr void _check() const
   {
-    if(_base::index() == 0)
+    if(!has_value())
     {
-      std::get_if<0>(this)->throw_exception();
+      this->_error.throw_exception();
     }
   }
-  constexpr
+  static constexpr
 #ifdef _MSC_VER
   __declspec(noreturn)
 #elif defined(__GNUC__) || defined(__clang__)
@@ -125,13 +284,26 @@ protected:
     __builtin_unreachable();
 #elif defined(_MSC_VER)
     __assume(0);
+#endif
+  }
+  template <class U> static constexpr _base _from(U &&o)
+  {
+    if(o.has_value())
+    {
+      return _base(std::in_place_index<1>, static_cast<U &&>(o)._value._v);
+    }
+    return _base(std::in_place_index<0>, static_cast<U &&>(o)._error);
+  }
+  static void _bad_result_access()
+  {
+#ifdef __cpp_exceptions
+    throw bad_result_access();
+#else
+    abort();
 #endif
   }
 
 public:
-  constexpr _base &_internal() noexcept { return *this; }
-  constexpr const _base &_internal() const noexcept { return *this; }
-
   //! Default constructor is disabled
   result() = delete;
   //! Copy constructor
@@ -148,34 +320,62 @@ public:
   //! Implicit result converting move constructor
   template <class U, std::enable_if_t<std::is_convertible_v<U, T>, bool> = true>
   constexpr result(result<U> &&o, _implicit_converting_constructor_tag = {}) noexcept(std::is_nothrow_constructible_v<T, U>)
-      : _base(std::move(o))
+      : _base(_from(std::move(o)))
   {
   }
   //! Implicit result converting copy constructor
   template <class U, std::enable_if_t<std::is_convertible_v<U, T>, bool> = true>
   constexpr result(const result<U> &o, _implicit_converting_constructor_tag = {}) noexcept(std::is_nothrow_constructible_v<T, U>)
-      : _base(o)
+      : _base(_from(o))
   {
   }
   //! Explicit result converting move constructor
   template <class U, std::enable_if_t<std::is_constructible_v<T, U>, bool> = true>
   constexpr explicit result(result<U> &&o, _explicit_converting_constructor_tag = {}) noexcept(std::is_nothrow_constructible_v<T, U>)
-      : _base(std::move(o))
+      : _base(_from(std::move(o)))
   {
   }
   //! Explicit result converting copy constructor
   template <class U, std::enable_if_t<std::is_constructible_v<T, U>, bool> = true>
   constexpr explicit result(const result<U> &o, _explicit_converting_constructor_tag = {}) noexcept(std::is_nothrow_constructible_v<T, U>)
-      : _base(o)
+      : _base(_from(o))
   {
   }
 
-  //! Anything which `std::variant<error, T>` will construct from, we shall implicitly construct from
-  using _base::_base;
+  //! Implicit value converting constructor
+  template <class U, std::enable_if_t<!std::is_same_v<std::decay_t<U>, result> && !is_result<std::decay_t<U>>::value  //
+                                      && std::is_convertible_v<U, value_type_if_enabled> && !std::is_convertible_v<U, error_type>,
+                                      bool> = true>
+  constexpr result(U &&v) noexcept(std::is_nothrow_constructible_v<value_type_if_enabled, U>)  // NOLINT
+      : _base(std::in_place_index<1>, static_cast<U &&>(v))
+  {
+  }
+  //! Implicit error converting constructor
+  template <class U, std::enable_if_t<!std::is_same_v<std::decay_t<U>, result> && !is_result<std::decay_t<U>>::value                   //
+                                      && std::is_convertible_v<U, error_type> && !std::is_convertible_v<U, value_type_if_enabled>  //
+                                      && std::is_void_v<typename detail::safe_get_make_status_code_result<U>::type>,                //
+                                      bool> = true>
+  constexpr result(U &&v) noexcept(std::is_nothrow_constructible_v<error_type, U>)  // NOLINT
+      : _base(std::in_place_index<0>, static_cast<U &&>(v))
+  {
+  }
 
+  //! In place value constructor
+  template <class... Args, std::enable_if_t<std::is_constructible_v<value_type_if_enabled, Args...>, bool> = true>
+  constexpr explicit result(std::in_place_type_t<value_type_if_enabled> /*unused*/, Args &&... args) noexcept(std::is_nothrow_constructible_v<value_type_if_enabled, Args...>)
+      : _base(std::in_place_index<1>, static_cast<Args &&>(args)...)
+  {
+  }
+  //! In place error constructor
+  template <class... Args, std::enable_if_t<std::is_constructible_v<error_type, Args...>, bool> = true>
+  constexpr explicit result(std::in_place_type_t<error_type> /*unused*/, Args &&... args) noexcept(std::is_nothrow_constructible_v<error_type, Args...>)
+      : _base(std::in_place_index<0>, static_cast<Args &&>(args)...)
+  {
+  }
   //! Special case `in_place_type_t<void>`
+  template <class U = T, std::enable_if_t<std::is_void_v<U>, bool> = true>
   constexpr explicit result(std::in_place_type_t<void> /*unused*/) noexcept
-      : _base(in_place_type<detail::void_>)
+      : _base(std::in_place_index<1>)
   {
   }
 
@@ -215,41 +415,46 @@ public:
   }
 
   //! Swap with another result
-  constexpr void swap(result &o) noexcept(std::is_nothrow_swappable_v<_base>) { _base::swap(o); }
+  constexpr void swap(result &o) noexcept(std::is_nothrow_move_constructible_v<value_type_if_enabled> &&std::is_nothrow_move_assignable_v<value_type_if_enabled>)
+  {
+    result temp(static_cast<result &&>(o));
+    o = static_cast<result &&>(*this);
+    *this = static_cast<result &&>(temp);
+  }
 
   //! Clone the result
   constexpr result clone() const { return has_value() ? result(value()) : result(error().clone()); }
 
   //! True if result has a value
-  constexpr bool has_value() const noexcept { return _base::index() == 1; }
+  constexpr bool has_value() const noexcept { return this->_has_value(); }
   //! True if result has a value
   explicit operator bool() const noexcept { return has_value(); }
   //! True if result has an error
-  constexpr bool has_error() const noexcept { return _base::index() == 0; }
+  constexpr bool has_error() const noexcept { return !this->_has_value(); }
 
   //! Accesses the value if one exists, else calls `.error().throw_exception()`.
   constexpr value_type_if_enabled &value() &
   {
     _check();
-    return std::get<1>(*this);
+    return this->_value._v;
   }
   //! Accesses the value if one exists, else calls `.error().throw_exception()`.
   constexpr const value_type_if_enabled &value() const &
   {
     _check();
-    return std::get<1>(*this);
+    return this->_value._v;
   }
   //! Accesses the value if one exists, else calls `.error().throw_exception()`.
   constexpr value_type_if_enabled &&value() &&
   {
     _check();
-    return std::get<1>(std::move(*this));
+    return std::move(this->_value._v);
   }
   //! Accesses the value if one exists, else calls `.error().throw_exception()`.
   constexpr const value_type_if_enabled &&value() const &&
   {
     _check();
-    return std::get<1>(std::move(*this));
+    return std::move(this->_value._v);
   }
 
   //! Accesses the error if one exists, else throws `bad_result_access`.
@@ -257,52 +462,36 @@ public:
   {
     if(!has_error())
     {
-#ifdef __cpp_exceptions
-      throw bad_result_access();
-#else
-      abort();
-#endif
+      _bad_result_access();
     }
-    return *std::get_if<0>(this);
+    return this->_error;
   }
   //! Accesses the error if one exists, else throws `bad_result_access`.
   constexpr const error_type &error() const &
   {
     if(!has_error())
     {
-#ifdef __cpp_exceptions
-      throw bad_result_access();
-#else
-      abort();
-#endif
+      _bad_result_access();
     }
-    return *std::get_if<0>(this);
+    return this->_error;
   }
   //! Accesses the error if one exists, else throws `bad_result_access`.
   constexpr error_type &&error() &&
   {
     if(!has_error())
     {
-#ifdef __cpp_exceptions
-      throw bad_result_access();
-#else
-      abort();
-#endif
+      _bad_result_access();
     }
-    return std::move(*std::get_if<0>(this));
+    return std::move(this->_error);
   }
   //! Accesses the error if one exists, else throws `bad_result_access`.
   constexpr const error_type &&error() const &&
   {
     if(!has_error())
     {
-#ifdef __cpp_exceptions
-      throw bad_result_access();
-#else
-      abort();
-#endif
+      _bad_result_access();
     }
-    return std::move(*std::get_if<0>(this));
+    return std::move(this->_error);
   }
 
   //! Accesses the value, being UB if none exists
@@ -312,7 +501,7 @@ public:
     {
       _ub();
     }
-    return *std::get_if<1>(this);
+    return this->_value._v;
   }
   //! Accesses the error, being UB if none exists
   constexpr const value_type_if_enabled &assume_value() const &noexcept
@@ -321,7 +510,7 @@ public:
     {
       _ub();
     }
-    return *std::get_if<1>(this);
+    return this->_value._v;
   }
   //! Accesses the error, being UB if none exists
   constexpr value_type_if_enabled &&assume_value() && noexcept
@@ -330,7 +519,7 @@ public:
     {
       _ub();
     }
-    return std::move(*std::get_if<1>(this));
+    return std::move(this->_value._v);
   }
   //! Accesses the error, being UB if none exists
   constexpr const value_type_if_enabled &&assume_value() const &&noexcept
@@ -339,7 +528,7 @@ public:
     {
       _ub();
     }
-    return std::move(*std::get_if<1>(this));
+    return std::move(this->_value._v);
   }
 
   //! Accesses the error, being UB if none exists
@@ -349,7 +538,7 @@ public:
     {
       _ub();
     }
-    return *std::get_if<0>(this);
+    return this->_error;
   }
   //! Accesses the error, being UB if none exists
   constexpr const error_type &assume_error() const &noexcept
@@ -358,7 +547,7 @@ public:
     {
       _ub();
     }
-    return *std::get_if<0>(this);
+    return this->_error;
   }
   //! Accesses the error, being UB if none exists
   constexpr error_type &&assume_error() && noexcept
@@ -367,7 +556,7 @@ public:
     {
       _ub();
     }
-    return std::move(*std::get_if<0>(this));
+    return std::move(this->_error);
   }
   //! Accesses the error, being UB if none exists
   constexpr const error_type &&assume_error() const &&noexcept
@@ -376,21 +565,39 @@ public:
     {
       _ub();
     }
-    return std::move(*std::get_if<0>(this));
+    return std::move(this->_error);
   }
 };
 
+namespace traits
+{
+  template <class T> struct is_move_bitcopying<result<T>>
+  {
+    static constexpr bool value = is_move_bitcopying<detail::devoid<T>>::value;
+  };
+  template <> struct is_move_bitcopying<detail::void_>
+  {
+    static constexpr bool value = true;
+  };
+}  // namespace traits
+
 //! True if the two results compare equal.
 template <class T, class U, typename = decltype(std::declval<T>() == std::declval<U>())> constexpr inline bool operator==(const result<T> &a, const result<U> &b) noexcept
 {
-  const auto &x = a._internal();
-  return x == b;
+  if(a.has_value() != b.has_value())
+  {
+    return false;
+  }
+  return a.has_value() ? (a.assume_value() == b.assume_value()) : (a.assume_error() == b.assume_error());
 }
 //! True if the two results compare unequal.
 template <class T, class U, typename = decltype(std::declval<T>() != std::declval<U>())> constexpr inline bool operator!=(const result<T> &a, const result<U> &b) noexcept
 {
-  const auto &x = a._internal();
-  return x != b;
+  if(a.has_value() != b.has_value())
+  {
+    return true;
+  }
+  return a.has_value() ? (a.assume_value() != b.assume_value()) : (a.assume_error() != b.assume_error());
 }
 
 SYSTEM_ERROR2_NAMESPACE_END
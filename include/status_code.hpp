@@ -25,10 +25,12 @@ http://www.boost.org/LICENSE_1_0.txt)
 #ifndef SYSTEM_ERROR2_STATUS_CODE_HPP
 #define SYSTEM_ERROR2_STATUS_CODE_HPP
 
+#include "domain_registry.hpp"
 #include "status_code_domain.hpp"
 
 #if(__cplusplus >= 201700 || _HAS_CXX17) && !defined(SYSTEM_ERROR2_DISABLE_STD_IN_PLACE)
 // 0.26
+#include <cstdint>  // for uintptr_t
 #include <utility>  // for in_place
 
 SYSTEM_ERROR2_NAMESPACE_BEGIN
@@ -89,6 +91,18 @@ namespace detail
     static constexpr bool value = true;
   };
 
+  /* True if erasing a code of the domain should cache whether it is a failure. Only domains which
+  can tell without a virtual function call do so, by declaring a static `_failure_of(const value_type &)`
+  which agrees with their `_do_failure()`. Asking any other domain would cost every erasure the very
+  call the cache is meant to save.
+  */
+  template <class DomainType, class = void> struct caches_failure_when_erased : std::false_type
+  {
+  };
+  template <class DomainType> struct caches_failure_when_erased<DomainType, decltype((void) DomainType::_failure_of(std::declval<const typename DomainType::value_type &>()))> : std::true_type
+  {
+  };
+
   // From http://www.open-std.org/jtc1/sc22/wg21/docs/papers/2015/n4436.pdf
   namespace impl
   {
@@ -138,9 +152,16 @@ public:
   using value_type = void;
   //! The type of a reference to a message string.
   using string_ref = typename status_code_domain::string_ref;
+  //! The type of a view of a message string which lives for the life of the process.
+  using message_view_type = typename status_code_domain::message_view_type;
 
 protected:
+  /* In erased status codes only, the low bit of `_domain` may be set to cache that the code
+  is known to be a failure, which saves a virtual function call. Typed status codes never
+  set it. Always dereference via `_domain_untagged()`.
+  */
   const status_code_domain *_domain{nullptr};
+  static_assert(alignof(status_code_domain) >= 2, "status_code_domain must be at least two byte aligned");
 
 protected:
   //! No default construction at type erased level
@@ -162,20 +183,54 @@ protected:
   {
   }
 
+#ifdef SYSTEM_ERROR2_HAVE_IS_CONSTANT_EVALUATED
+  // Codes are only ever tagged at runtime, so there is nothing to mask during constant evaluation
+  constexpr const status_code_domain *_domain_untagged() const noexcept { return __builtin_is_constant_evaluated() ? _domain : reinterpret_cast<const status_code_domain *>(reinterpret_cast<uintptr_t>(_domain) & ~static_cast<uintptr_t>(1)); }  // NOLINT
+  bool _failure_cached() const noexcept { return (reinterpret_cast<uintptr_t>(_domain) & 1) != 0; }  // NOLINT
+  // Only for non-empty erased status codes which are known to be failures
+  void _cache_failure() noexcept { _domain = _failure_tagged(_domain); }
+  static const status_code_domain *_failure_tagged(const status_code_domain *d) noexcept { return reinterpret_cast<const status_code_domain *>(reinterpret_cast<uintptr_t>(d) | 1); }  // NOLINT
+#else
+  // Masking could not be told apart from constant evaluation, so failures are never cached and `domain()` stays constexpr
+  constexpr const status_code_domain *_domain_untagged() const noexcept { return _domain; }
+  constexpr bool _failure_cached() const noexcept { return false; }
+  void _cache_failure() noexcept {}
+#endif
+  // As stored, so erasing an erased code keeps any cached failure
   constexpr const status_code_domain *_domain_ptr() const noexcept { return _domain; }
 
 public:
   //! Return the status code domain.
-  constexpr const status_code_domain &domain() const noexcept { return *_domain; }
+  constexpr const status_code_domain &domain() const noexcept { return *_domain_untagged(); }
   //! True if the status code is empty.
   SYSTEM_ERROR2_NODISCARD constexpr bool empty() const noexcept { return _domain == nullptr; }
 
   //! Return a reference to a string textually representing a code.
-  string_ref message() const noexcept { return (_domain != nullptr) ? _domain->_do_message(*this) : string_ref("(empty)"); }
+  string_ref message() const noexcept { return (_domain != nullptr) ? _domain_untagged()->_do_message(*this) : string_ref("(empty)"); }
+  /*! Write a string textually representing a code into `buffer` of `bytes` bytes, truncated and null terminated,
+  returning the length it would have had if not truncated, as with `snprintf()`. For the generic, POSIX and
+  `getaddrinfo()` domains, and domains wrapping them, this never allocates nor locks, so is safe to call from
+  within a signal handler. Other domains may fall back onto `message()`.
+  */
+  size_t format_message_to(char *buffer, size_t bytes) const noexcept
+  {
+    if(_domain == nullptr)
+    {
+      detail::message_writer w(buffer, bytes);
+      w.append("(empty)", 7);
+      return w.finish();
+    }
+    return _domain_untagged()->_do_format_message(*this, buffer, bytes);
+  }
+  /*! Return a view of a string textually representing a code, without constructing a `string_ref`,
+  if the domain keeps its messages in an immutable table for the life of the process, as the generic
+  and `getaddrinfo()` domains do. Otherwise the view has a null `data()`, and `message()` must be used.
+  */
+  message_view_type message_view() const noexcept { return (_domain != nullptr) ? _domain_untagged()->_do_message_view(*this) : message_view_type("(empty)"); }
   //! True if code means success.
-  bool success() const noexcept { return (_domain != nullptr) ? !_domain->_do_failure(*this) : false; }
+  bool success() const noexcept { return (_domain != nullptr) ? (!_failure_cached() && !_domain_untagged()->_do_failure(*this)) : false; }
   //! True if code means failure.
-  bool failure() const noexcept { return (_domain != nullptr) ? _domain->_do_failure(*this) : false; }
+  bool failure() const noexcept { return (_domain != nullptr) ? (_failure_cached() || _domain_untagged()->_do_failure(*this)) : false; }
   /*! True if code is strictly (and potentially non-transitively) semantically equivalent to another code in another domain.
   Note that usually non-semantic i.e. pure value comparison is used when the other status code has the same domain.
   As `equivalent()` will try mapping to generic code, this usually captures when two codes have the same semantic
@@ -185,7 +240,7 @@ public:
   {
     if(_domain && o._domain)
     {
-      return _domain->_do_equivalent(*this, o);
+      return _domain_untagged()->_do_equivalent(*this, o);
     }
     // If we are both empty, we are equivalent
     if(!_domain && !o._domain)
@@ -196,15 +251,24 @@ public:
     return false;
   }
   /*! True if code is equivalent, by any means, to another code in another domain (guaranteed transitive).
-  Firstly `strictly_equivalent()` is run in both directions. If neither succeeds, each domain is asked
-  for the equivalent generic code and those are compared.
+  If a function was registered for the two domains by `register_equivalence()`, it decides. Otherwise
+  `strictly_equivalent()` is run in both directions. If neither succeeds, each domain is asked for the
+  equivalent generic code and those are compared.
   */
   template <class T> inline bool equivalent(const status_code<T> &o) const noexcept;
+  /*! True if the generic code equivalent to this code is a member of `s`. This asks the domain for
+  the equivalent generic code once, and then tests a bit, so is much cheaper than comparing against
+  each member in turn, though only as wide as the generic code mapping of this code's domain.
+  Empty codes are members of no set.
+  */
+  inline bool in(const errc_set &s) const noexcept;
 #if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(STANDARDESE_IS_IN_THE_HOUSE)
   //! Throw a code as a C++ exception.
   SYSTEM_ERROR2_NORETURN void throw_exception() const
   {
-    _domain->_do_throw_exception(*this);
+    // The value type is not known here, so the tracepoint gets the address of the code
+    SYSTEM_ERROR2_USDT_PROBE(throw, _domain_untagged()->id(), reinterpret_cast<intptr_t>(this));  // NOLINT
+    _domain_untagged()->_do_throw_exception(*this);
     abort();  // suppress buggy GCC warning
   }
 #endif
@@ -212,6 +276,17 @@ public:
 
 namespace detail
 {
+#ifdef SYSTEM_ERROR2_USDT_CONSTEXPR_PROBES
+  // Called from constexpr constructors, which cannot contain inline assembly before C++ 20
+  inline void usdt_construct(unsigned long long id, intptr_t value) noexcept { SYSTEM_ERROR2_USDT_PROBE(construct, id, value); }
+  inline void usdt_erase(const status_code_domain *domain, intptr_t value) noexcept
+  {
+    if(domain != nullptr)
+    {
+      SYSTEM_ERROR2_USDT_PROBE(erase, domain->id(), value);
+    }
+  }
+#endif
   template <class DomainType> struct get_domain_value_type
   {
     using domain_type = DomainType;
@@ -243,7 +318,7 @@ namespace detail
 
     // Replace the type erased implementations with type aware implementations for better codegen
     //! Return the status code domain.
-    constexpr const domain_type &domain() const noexcept { return *static_cast<const domain_type *>(this->_domain); }
+    constexpr const domain_type &domain() const noexcept { return _domain_ref(std::is_same<domain_type, status_code_domain>()); }
 
     //! Reset the code to empty.
     SYSTEM_ERROR2_CONSTEXPR14 void clear() noexcept
@@ -257,12 +332,12 @@ namespace detail
     //! Return a reference to the `value_type`.
     constexpr value_type &value() & noexcept { return this->_value; }
     //! Return a reference to the `value_type`.
-    constexpr value_type &&value() && noexcept { return this->_value; }
+    constexpr value_type &&value() && noexcept { return static_cast<value_type &&>(this->_value); }
 #endif
     //! Return a reference to the `value_type`.
     constexpr const value_type &value() const &noexcept { return this->_value; }
     //! Return a reference to the `value_type`.
-    constexpr const value_type &&value() const &&noexcept { return this->_value; }
+    constexpr const value_type &&value() const &&noexcept { return static_cast<const value_type &&>(this->_value); }
 
   protected:
     status_code_storage() = default;
@@ -282,6 +357,10 @@ namespace detail
     }
     ~status_code_storage() = default;
 
+    // Typed status codes are only ever of their domain's singleton
+    constexpr const domain_type &_domain_ref(std::false_type /*unused*/) const noexcept { return domain_type::get(); }
+    const domain_type &_domain_ref(std::true_type /*unused*/) const noexcept { return *this->_domain_untagged(); }
+
     value_type _value{};
     struct _value_type_constructor
     {
@@ -354,22 +433,46 @@ public:
   constexpr explicit status_code(in_place_t /*unused */, Args &&... args) noexcept(std::is_nothrow_constructible<value_type, Args &&...>::value)
       : _base(typename _base::_value_type_constructor{}, &domain_type::get(), static_cast<Args &&>(args)...)
   {
+#ifdef SYSTEM_ERROR2_USDT_CONSTEXPR_PROBES
+    if(!__builtin_is_constant_evaluated())
+    {
+      detail::usdt_construct(domain_type::get().id(), detail::diagnostic_value(this->_value));
+    }
+#endif
   }
   //! Explicit in-place construction from initialiser list.
   template <class T, class... Args>
   constexpr explicit status_code(in_place_t /*unused */, std::initializer_list<T> il, Args &&... args) noexcept(std::is_nothrow_constructible<value_type, std::initializer_list<T>, Args &&...>::value)
       : _base(typename _base::_value_type_constructor{}, &domain_type::get(), il, static_cast<Args &&>(args)...)
   {
+#ifdef SYSTEM_ERROR2_USDT_CONSTEXPR_PROBES
+    if(!__builtin_is_constant_evaluated())
+    {
+      detail::usdt_construct(domain_type::get().id(), detail::diagnostic_value(this->_value));
+    }
+#endif
   }
   //! Explicit copy construction from a `value_type`.
   constexpr explicit status_code(const value_type &v) noexcept(std::is_nothrow_copy_constructible<value_type>::value)
       : _base(typename _base::_value_type_constructor{}, &domain_type::get(), v)
   {
+#ifdef SYSTEM_ERROR2_USDT_CONSTEXPR_PROBES
+    if(!__builtin_is_constant_evaluated())
+    {
+      detail::usdt_construct(domain_type::get().id(), detail::diagnostic_value(this->_value));
+    }
+#endif
   }
   //! Explicit move construction from a `value_type`.
   constexpr explicit status_code(value_type &&v) noexcept(std::is_nothrow_move_constructible<value_type>::value)
       : _base(typename _base::_value_type_constructor{}, &domain_type::get(), static_cast<value_type &&>(v))
   {
+#ifdef SYSTEM_ERROR2_USDT_CONSTEXPR_PROBES
+    if(!__builtin_is_constant_evaluated())
+    {
+      detail::usdt_construct(domain_type::get().id(), detail::diagnostic_value(this->_value));
+    }
+#endif
   }
   /*! Explicit construction from an erased status code. Available only if
   `value_type` is trivially copyable or move bitcopying, and `sizeof(status_code) <= sizeof(status_code<erased<>>)`.
@@ -417,8 +520,22 @@ is made available.
 template <class ErasedType> class SYSTEM_ERROR2_TRIVIAL_ABI status_code<erased<ErasedType>> : public mixins::mixin<detail::status_code_storage<erased<ErasedType>>, erased<ErasedType>>
 {
   template <class T> friend class status_code;
+  friend struct detail::wire_codec;
+  friend class portable_code;
   using _base = mixins::mixin<detail::status_code_storage<erased<ErasedType>>, erased<ErasedType>>;
 
+  // Erasing a failure caches that it is one, so failure() and success() need not ask the domain
+  template <class DomainType> static constexpr const status_code_domain *_erasing_domain_ptr(const status_code<DomainType> &v, std::true_type /*unused*/) noexcept
+  {
+#ifdef SYSTEM_ERROR2_HAVE_IS_CONSTANT_EVALUATED
+    return (__builtin_is_constant_evaluated() || v.empty() || !DomainType::_failure_of(v.value())) ? v._domain_ptr() : _base::_failure_tagged(v._domain_ptr());
+#else
+    return v._domain_ptr();
+#endif
+  }
+  // Erased sources keep whatever they have cached, and other domains are not asked
+  template <class DomainType> static constexpr const status_code_domain *_erasing_domain_ptr(const status_code<DomainType> &v, std::false_type /*unused*/) noexcept { return v._domain_ptr(); }
+
 public:
   //! The type of the domain (void, as it is erased).
   using domain_type = void;
@@ -427,6 +544,13 @@ public:
   //! The type of a reference to a message string.
   using string_ref = typename _base::string_ref;
 
+private:
+  // Used by decoders and portable_code, which only know the domain at runtime. The value must be one of that domain.
+  constexpr status_code(const status_code_domain *domain, value_type v) noexcept
+      : _base(typename _base::_value_type_constructor{}, domain, v)
+  {
+  }
+
 public:
   //! Default construction to empty
   status_code() = default;
@@ -442,7 +566,7 @@ public:
   {
     if(nullptr != this->_domain)
     {
-      this->_domain->_do_erased_destroy(*this, sizeof(*this));
+      this->_domain_untagged()->_do_erased_destroy(*this, sizeof(*this));
     }
   }
 
@@ -454,10 +578,24 @@ public:
       return {};
     }
     status_code x;
-    this->_domain->_do_erased_copy(x, *this, sizeof(*this));
+    this->_domain_untagged()->_do_erased_copy(x, *this, sizeof(*this));
     return x;
   }
 
+  using _base::equivalent;
+  /*! True if code is equivalent, by any means, to another code in another domain (guaranteed transitive).
+  If both codes are of the same domain, and that domain's equivalence is value equality, this is a
+  comparison of domain ids and erased values with no virtual function calls.
+  */
+  bool equivalent(const status_code &o) const noexcept
+  {
+    if(this->_domain != nullptr && o._domain != nullptr && (this->_domain_untagged() == o._domain_untagged() || this->_domain_untagged()->id() == o._domain_untagged()->id()) && this->_domain_untagged()->equivalence_is_value_equality())
+    {
+      return 0 == memcmp(&this->_value, &o._value, sizeof(value_type));  // NOLINT
+    }
+    return _base::equivalent(o);
+  }
+
   /***** KEEP THESE IN SYNC WITH ERRORED_STATUS_CODE *****/
   //! Implicit copy construction from any other status code if its value type is trivially copyable and it would fit into our storage
   template <class DomainType,                                                                              //
@@ -466,15 +604,27 @@ public:
                                     && detail::type_erasure_is_safe<value_type, typename DomainType::value_type>::value,
                                     bool>::type = true>
   constexpr status_code(const status_code<DomainType> &v) noexcept  // NOLINT
-      : _base(typename _base::_value_type_constructor{}, v._domain_ptr(), detail::erasure_cast<value_type>(v.value()))
+      : _base(typename _base::_value_type_constructor{}, _erasing_domain_ptr(v, detail::caches_failure_when_erased<DomainType>{}), detail::erasure_cast<value_type>(v.value()))
   {
+#ifdef SYSTEM_ERROR2_USDT_CONSTEXPR_PROBES
+    if(!__builtin_is_constant_evaluated())
+    {
+      detail::usdt_erase(this->_domain_untagged(), detail::diagnostic_value(this->_value));
+    }
+#endif
   }
   //! Implicit move construction from any other status code if its value type is trivially copyable or move bitcopying and it would fit into our storage
   template <class DomainType,  //
             typename std::enable_if<detail::type_erasure_is_safe<value_type, typename DomainType::value_type>::value, bool>::type = true>
   SYSTEM_ERROR2_CONSTEXPR14 status_code(status_code<DomainType> &&v) noexcept  // NOLINT
-      : _base(typename _base::_value_type_constructor{}, v._domain_ptr(), detail::erasure_cast<value_type>(v.value()))
+      : _base(typename _base::_value_type_constructor{}, _erasing_domain_ptr(v, detail::caches_failure_when_erased<DomainType>{}), detail::erasure_cast<value_type>(v.value()))
   {
+#ifdef SYSTEM_ERROR2_USDT_CONSTEXPR_PROBES
+    if(!__builtin_is_constant_evaluated())
+    {
+      detail::usdt_erase(this->_domain_untagged(), detail::diagnostic_value(this->_value));
+    }
+#endif
     v._domain = nullptr;
   }
   //! Implicit construction from any type where an ADL discovered `make_status_code(T, Args ...)` returns a `status_code`.
@@ -505,6 +655,90 @@ namespace traits
   };
 }  // namespace traits
 
+namespace detail
+{
+  template <class DomainType> inline unsigned long long exact_domain_id(const status_code<DomainType> &c) noexcept { return c.empty() ? 0 : c.domain().id(); }
+  // Mixes the bytes of the value into the domain's id eight bytes at a time
+  template <class T> inline size_t exact_hash_value(unsigned long long id, const T &v) noexcept
+  {
+    const auto *bytes = reinterpret_cast<const unsigned char *>(&v);  // NOLINT
+    unsigned long long h = id;
+    for(size_t n = 0; n < sizeof(T); n += sizeof(unsigned long long))
+    {
+      unsigned long long w = 0;
+      memcpy(&w, bytes + n, (sizeof(T) - n < sizeof(w)) ? (sizeof(T) - n) : sizeof(w));  // NOLINT
+      h = (h ^ w) * 0x9e3779b97f4a7c15ULL;
+      h ^= h >> 32;
+    }
+    return static_cast<size_t>(h);
+  }
+}  // namespace detail
+
+/*! A hash of a status code which is exact, rather than semantic. It combines the id of the
+code's domain with the bytes of its value. Suitable for keying unordered containers
+together with `exact_equal`. Value types must be trivially copyable or move bitcopying,
+and should not contain padding, as padding bytes are hashed.
+*/
+struct exact_hash
+{
+  template <class DomainType> size_t operator()(const status_code<DomainType> &c) const noexcept
+  {
+    static_assert(traits::is_move_bitcopying<typename status_code<DomainType>::value_type>::value, "exact_hash requires a value type which is trivially copyable or move bitcopying");
+    if(c.empty())
+    {
+      return 0;
+    }
+    const auto &v = c.value();
+    return detail::exact_hash_value(c.domain().id(), v);
+  }
+};
+
+/*! True if two status codes are exactly, rather than semantically, equal. That is, if
+both are empty, or if their domains have the same id and their values the same bytes.
+*/
+struct exact_equal
+{
+  template <class DomainType> bool operator()(const status_code<DomainType> &a, const status_code<DomainType> &b) const noexcept
+  {
+    static_assert(traits::is_move_bitcopying<typename status_code<DomainType>::value_type>::value, "exact_equal requires a value type which is trivially copyable or move bitcopying");
+    if(detail::exact_domain_id(a) != detail::exact_domain_id(b) || a.empty() != b.empty())
+    {
+      return false;
+    }
+    if(a.empty())
+    {
+      return true;
+    }
+    const auto &va = a.value();
+    const auto &vb = b.value();
+    return 0 == memcmp(&va, &vb, sizeof(va));  // NOLINT
+  }
+};
+
+/*! An exact strict weak ordering of status codes, suitable for keying ordered containers.
+Empty codes order first, then codes order by the id of their domain, then by the bytes
+of their value. The order of values is therefore consistent, but not numeric.
+*/
+struct exact_less
+{
+  template <class DomainType> bool operator()(const status_code<DomainType> &a, const status_code<DomainType> &b) const noexcept
+  {
+    static_assert(traits::is_move_bitcopying<typename status_code<DomainType>::value_type>::value, "exact_less requires a value type which is trivially copyable or move bitcopying");
+    if(a.empty() || b.empty())
+    {
+      return a.empty() && !b.empty();
+    }
+    const auto ida = a.domain().id(), idb = b.domain().id();
+    if(ida != idb)
+    {
+      return ida < idb;
+    }
+    const auto &va = a.value();
+    const auto &vb = b.value();
+    return memcmp(&va, &vb, sizeof(va)) < 0;  // NOLINT
+  }
+};
+
 SYSTEM_ERROR2_NAMESPACE_END
 
 #endif
@@ -0,0 +1,392 @@
+/* Sharded counters of status code occurrences
+(C) 2026 agent <agent@local> (3 commits)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef SYSTEM_ERROR2_STATUS_CODE_COUNTERS_HPP
+#define SYSTEM_ERROR2_STATUS_CODE_COUNTERS_HPP
+
+#include "status_code.hpp"
+
+#include <cstdint>
+#include <cstdio>  // for snprintf
+#include <string>
+#include <vector>
+
+#ifndef SYSTEM_ERROR2_COUNTERS_SHARDS
+//! The number of shards of the occurrence counter table. Threads are spread across these.
+#define SYSTEM_ERROR2_COUNTERS_SHARDS 16
+#endif
+#ifndef SYSTEM_ERROR2_COUNTERS_SLOTS
+//! The number of distinct status codes each shard of the occurrence counter table can count. Must be a power of two.
+#define SYSTEM_ERROR2_COUNTERS_SLOTS 128
+#endif
+
+SYSTEM_ERROR2_NAMESPACE_BEGIN
+
+namespace detail
+{
+  static_assert((SYSTEM_ERROR2_COUNTERS_SLOTS & (SYSTEM_ERROR2_COUNTERS_SLOTS - 1)) == 0, "SYSTEM_ERROR2_COUNTERS_SLOTS must be a power of two");
+
+  struct status_code_counter_slot
+  {
+    std::atomic<const status_code_domain *> domain;  // null if unused
+    std::atomic<intptr_t> value;
+    std::atomic<uint64_t> count;
+  };
+  struct alignas(64) status_code_counter_shard
+  {
+    status_code_counter_slot slots[SYSTEM_ERROR2_COUNTERS_SLOTS];
+    std::atomic<uint64_t> dropped;
+    std::atomic<bool> owned;
+    std::atomic<unsigned> epoch;  // counts are only current if this equals the table's
+  };
+  // A template so the table has static storage duration and is zero initialised without a guard.
+  // The final shard is never owned, and is shared by all threads which could not own a shard.
+  template <class = void> struct status_code_counter_table
+  {
+    static status_code_counter_shard shards[SYSTEM_ERROR2_COUNTERS_SHARDS + 1];
+    static std::atomic<unsigned> next_shard;
+    static std::atomic<unsigned> epoch;  // incremented by each reset
+  };
+  template <class T> status_code_counter_shard status_code_counter_table<T>::shards[SYSTEM_ERROR2_COUNTERS_SHARDS + 1];
+  template <class T> std::atomic<unsigned> status_code_counter_table<T>::next_shard;
+  template <class T> std::atomic<unsigned> status_code_counter_table<T>::epoch;
+}  // namespace detail
+
+/*! Lock free counters of how often each status code, keyed by its domain's id and its
+value, has been recorded. Opt in by calling `record()`, or by defining `SYSTEM_ERROR2_ERROR_COUNTERS`
+which causes each construction of an `errored_status_code` to be recorded.
+
+Each thread takes sole ownership of one of `SYSTEM_ERROR2_COUNTERS_SHARDS` shards of the table
+until it exits, and so can increment its counters without atomic read-modify-write instructions.
+Threads beyond that number share one further shard, and increment its counters atomically.
+Recording never takes a lock nor allocates. Each shard can count `SYSTEM_ERROR2_COUNTERS_SLOTS`
+distinct codes; any more are counted as dropped. Only status codes whose value type would
+erase into `intptr_t` can be recorded. Domains recorded must outlive the table, which is
+true of the usual statically allocated domains.
+*/
+class status_code_counters
+{
+  using _table = detail::status_code_counter_table<>;
+  using _shard_type = detail::status_code_counter_shard;
+  static constexpr size_t _mask = SYSTEM_ERROR2_COUNTERS_SLOTS - 1;
+
+  // Trivially destructible, so it remains usable by thread_local destructors which run after the releaser
+  struct _thread_state
+  {
+    _shard_type *shard;  // null if not yet assigned
+    bool exclusive, dead;
+  };
+  static _thread_state &_state() noexcept
+  {
+    static thread_local _thread_state v;
+    return v;
+  }
+  struct _releaser
+  {
+    _releaser() = default;
+    _releaser(const _releaser &) = delete;
+    _releaser(_releaser &&) = delete;
+    _releaser &operator=(const _releaser &) = delete;
+    _releaser &operator=(_releaser &&) = delete;
+    ~_releaser()
+    {
+      auto &s = _state();
+      s.shard->owned.store(false, std::memory_order_release);
+      s.shard = &_table::shards[SYSTEM_ERROR2_COUNTERS_SHARDS];
+      s.exclusive = false;
+      s.dead = true;
+    }
+  };
+  static void _assign(_thread_state &s) noexcept
+  {
+    s.shard = &_table::shards[SYSTEM_ERROR2_COUNTERS_SHARDS];
+    s.exclusive = false;
+    if(s.dead)
+    {
+      return;
+    }
+    const unsigned start = _table::next_shard.fetch_add(1, std::memory_order_relaxed);
+    for(unsigned n = 0; n < SYSTEM_ERROR2_COUNTERS_SHARDS; n++)
+    {
+      auto &shard = _table::shards[(start + n) % SYSTEM_ERROR2_COUNTERS_SHARDS];
+      bool expected = false;
+      if(!shard.owned.load(std::memory_order_relaxed) && shard.owned.compare_exchange_strong(expected, true, std::memory_order_acquire, std::memory_order_relaxed))
+      {
+        s.shard = &shard;
+        s.exclusive = true;
+        static thread_local _releaser r;
+        (void) r;
+        return;
+      }
+    }
+  }
+
+  // Zeroes the counts of an owned shard if reset since, which only its owner may do
+  static void _catch_up(_shard_type &shard) noexcept
+  {
+    const unsigned epoch = _table::epoch.load(std::memory_order_acquire);
+    if(shard.epoch.load(std::memory_order_relaxed) == epoch)
+    {
+      return;
+    }
+    for(auto &slot : shard.slots)
+    {
+      slot.count.store(0, std::memory_order_relaxed);
+    }
+    shard.dropped.store(0, std::memory_order_relaxed);
+    shard.epoch.store(epoch, std::memory_order_release);
+  }
+  // The shared shard is reset directly, and owned shards not yet caught up have no counts since the reset
+  static bool _current(const _shard_type &shard) noexcept { return &shard == &_table::shards[SYSTEM_ERROR2_COUNTERS_SHARDS] || shard.epoch.load(std::memory_order_acquire) == _table::epoch.load(std::memory_order_acquire); }
+
+  static const status_code_domain *_busy() noexcept { return reinterpret_cast<const status_code_domain *>(static_cast<uintptr_t>(1)); }  // NOLINT
+  static size_t _hash(status_code_domain::unique_id_type id, intptr_t value) noexcept
+  {
+    const uint64_t h = (id ^ static_cast<uint64_t>(value)) * 0x9e3779b97f4a7c15ULL;
+    return static_cast<size_t>(h ^ (h >> 29)) & _mask;
+  }
+  // Only this thread writes to an owned shard, so slots are claimed and incremented with plain stores
+  static void _record_exclusive(_shard_type &shard, const status_code_domain *domain, intptr_t value) noexcept
+  {
+    const auto id = domain->id();
+    size_t idx = _hash(id, value);
+    for(size_t probe = 0; probe <= _mask; probe++, idx = (idx + 1) & _mask)
+    {
+      auto &slot = shard.slots[idx];
+      const status_code_domain *d = slot.domain.load(std::memory_order_relaxed);
+      if(d == nullptr)
+      {
+        slot.value.store(value, std::memory_order_relaxed);
+        slot.count.store(1, std::memory_order_relaxed);
+        slot.domain.store(domain, std::memory_order_release);
+        return;
+      }
+      if((d == domain || d->id() == id) && slot.value.load(std::memory_order_relaxed) == value)
+      {
+        slot.count.store(slot.count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+      }
+    }
+    shard.dropped.store(shard.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+  static void _record_shared(_shard_type &shard, const status_code_domain *domain, intptr_t value) noexcept
+  {
+    const auto id = domain->id();
+    size_t idx = _hash(id, value);
+    for(size_t probe = 0; probe <= _mask; probe++, idx = (idx + 1) & _mask)
+    {
+      auto &slot = shard.slots[idx];
+      const status_code_domain *d = slot.domain.load(std::memory_order_acquire);
+      if(d == nullptr)
+      {
+        if(slot.domain.compare_exchange_strong(d, _busy(), std::memory_order_acquire, std::memory_order_acquire))
+        {
+          slot.value.store(value, std::memory_order_relaxed);
+          slot.count.fetch_add(1, std::memory_order_relaxed);
+          slot.domain.store(domain, std::memory_order_release);
+          return;
+        }
+      }
+      while(d == _busy())
+      {
+        d = slot.domain.load(std::memory_order_acquire);
+      }
+      if((d == domain || d->id() == id) && slot.value.load(std::memory_order_relaxed) == value)
+      {
+        slot.count.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+    }
+    shard.dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+  static void _record(const status_code_domain *domain, intptr_t value) noexcept
+  {
+    auto &s = _state();
+    if(s.shard == nullptr)
+    {
+      _assign(s);
+    }
+    if(s.exclusive)
+    {
+      _catch_up(*s.shard);
+      _record_exclusive(*s.shard, domain, value);
+    }
+    else
+    {
+      _record_shared(*s.shard, domain, value);
+    }
+  }
+  static void _append_escaped(std::string &out, const char *s, size_t len)
+  {
+    for(size_t n = 0; n < len; n++)
+    {
+      switch(s[n])
+      {
+      case '\\':
+        out.append("\\\\");
+        break;
+      case '"':
+        out.append("\\\"");
+        break;
+      case '\n':
+        out.append("\\n");
+        break;
+      default:
+        out.push_back(s[n]);
+      }
+    }
+  }
+
+public:
+  //! An aggregated count of one status code
+  struct entry
+  {
+    //! The domain of the status code. If several domain instances share an id, one of them.
+    const status_code_domain *domain;
+    //! The value of the status code, erased into an `intptr_t`
+    intptr_t value;
+    //! How many times the status code was recorded
+    uint64_t count;
+  };
+
+  //! Record one occurrence of `code`. Does nothing if `code` is empty.
+  template <class DomainType, typename std::enable_if<detail::type_erasure_is_safe<intptr_t, typename status_code<DomainType>::value_type>::value, bool>::type = true>  //
+  static void record(const status_code<DomainType> &code) noexcept
+  {
+    if(!code.empty())
+    {
+      _record(&code.domain(), detail::erasure_cast<intptr_t>(code.value()));
+    }
+  }
+
+  //! Returns the counts of all status codes recorded so far, summed across shards.
+  static std::vector<entry> snapshot()
+  {
+    std::vector<entry> ret;
+    for(auto &shard : _table::shards)
+    {
+      const bool current = _current(shard);
+      for(auto &slot : shard.slots)
+      {
+        const status_code_domain *d = slot.domain.load(std::memory_order_acquire);
+        if(d == nullptr || d == _busy())
+        {
+          continue;
+        }
+        const intptr_t value = slot.value.load(std::memory_order_relaxed);
+        const uint64_t count = current ? slot.count.load(std::memory_order_relaxed) : 0;
+        bool merged = false;
+        for(auto &e : ret)
+        {
+          if(e.domain->id() == d->id() && e.value == value)
+          {
+            e.count += count;
+            merged = true;
+            break;
+          }
+        }
+        if(!merged)
+        {
+          ret.push_back(entry{d, value, count});
+        }
+      }
+    }
+    return ret;
+  }
+
+  //! Returns how many occurrences could not be counted because a shard was full.
+  static uint64_t dropped() noexcept
+  {
+    uint64_t ret = 0;
+    for(auto &shard : _table::shards)
+    {
+      if(_current(shard))
+      {
+        ret += shard.dropped.load(std::memory_order_relaxed);
+      }
+    }
+    return ret;
+  }
+
+  /*! Zeroes all counts. Status codes already seen keep their slots. Counts of shards owned by a thread are
+  only ever written by that thread, so each is zeroed by its owner when it next records, and until then is
+  reported as zero. Occurrences recorded concurrently with the reset may or may not be counted.
+  */
+  static void reset() noexcept
+  {
+    const unsigned epoch = _table::epoch.fetch_add(1, std::memory_order_acq_rel) + 1;
+    // The shared shard is only ever incremented atomically, so can be zeroed from here
+    auto &shared = _table::shards[SYSTEM_ERROR2_COUNTERS_SHARDS];
+    for(auto &slot : shared.slots)
+    {
+      slot.count.store(0, std::memory_order_relaxed);
+    }
+    shared.dropped.store(0, std::memory_order_relaxed);
+    shared.epoch.store(epoch, std::memory_order_release);
+  }
+
+  /*! Renders `snapshot()` in the Prometheus text exposition format as a counter called `metric`,
+  labelled by the domain's `name()`, the domain's id in hexadecimal, and the value.
+  */
+  static std::string prometheus_text(const char *metric = "status_code_failures_total")
+  {
+    std::string out;
+    char buffer[64];
+    out.append("# HELP ").append(metric).append(" Number of status codes recorded, by domain and value.\n");
+    out.append("# TYPE ").append(metric).append(" counter\n");
+    for(const auto &e : snapshot())
+    {
+      out.append(metric).append("{domain=\"");
+      auto name = e.domain->name();
+      _append_escaped(out, name.c_str(), name.size());
+      snprintf(buffer, sizeof(buffer), "\",domain_id=\"0x%016llx\",value=\"%lld\"} ", static_cast<unsigned long long>(e.domain->id()), static_cast<long long>(e.value));
+      out.append(buffer);
+      snprintf(buffer, sizeof(buffer), "%llu\n", static_cast<unsigned long long>(e.count));
+      out.append(buffer);
+    }
+    out.append("# HELP ").append(metric).append("_dropped Number of status codes not recorded as the table was full.\n");
+    out.append("# TYPE ").append(metric).append("_dropped counter\n");
+    snprintf(buffer, sizeof(buffer), "_dropped %llu\n", static_cast<unsigned long long>(dropped()));
+    out.append(metric).append(buffer);
+    return out;
+  }
+};
+
+namespace detail
+{
+  // Used by errored_status_code when SYSTEM_ERROR2_ERROR_COUNTERS is defined, so codes which cannot be recorded are ignored
+  template <class DomainType, typename std::enable_if<type_erasure_is_safe<intptr_t, typename status_code<DomainType>::value_type>::value, bool>::type = true>  //
+  inline void record_status_code_occurrence(const status_code<DomainType> &code) noexcept
+  {
+    status_code_counters::record(code);
+  }
+  template <class DomainType, typename std::enable_if<!type_erasure_is_safe<intptr_t, typename status_code<DomainType>::value_type>::value, bool>::type = true>  //
+  inline void record_status_code_occurrence(const status_code<DomainType> & /*unused*/) noexcept
+  {
+  }
+}  // namespace detail
+
+SYSTEM_ERROR2_NAMESPACE_END
+
+#endif
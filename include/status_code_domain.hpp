@@ -36,17 +36,73 @@ SYSTEM_ERROR2_NAMESPACE_BEGIN
 Be careful of placing these into containers! Equality and inequality operators are
 *semantic* not exact. Therefore two distinct items will test true! To help prevent
 surprise on this, `operator<` and `std::hash<>` are NOT implemented in order to
-trap potential incorrectness. Define your own custom comparison functions for your
-container which perform exact comparisons.
+trap potential incorrectness. Use `exact_hash`, `exact_equal` and `exact_less`,
+or `status_code_flat_map`, to key containers by exact comparison.
 */
 template <class DomainType> class status_code;
 class _generic_code_domain;
 //! The generic code is a status code with the generic code domain, which is that of `errc` (POSIX).
 using generic_code = status_code<_generic_code_domain>;
+class errc_set;
+class portable_code;
+template <class Base, size_t Slots> class cached_message_domain;
 
 namespace detail
 {
-  template <class StatusCode> class indirecting_domain;
+  /* Writes into a fixed size buffer, truncating, whilst counting the untruncated length. Never
+  allocates nor locks, so is safe to use from within a signal handler.
+  */
+  class message_writer
+  {
+    char *_buffer;
+    size_t _bytes, _length{0};
+
+  public:
+    message_writer(char *buffer, size_t bytes) noexcept
+        : _buffer(buffer)
+        , _bytes(bytes)
+    {
+    }
+    void append(const char *s, size_t n) noexcept
+    {
+      if(_length + 1 < _bytes)
+      {
+        const size_t space = _bytes - 1 - _length;
+        memcpy(_buffer + _length, s, (n < space) ? n : space);  // NOLINT
+      }
+      _length += n;
+    }
+    void append(const char *s) noexcept { append(s, strlen(s)); }  // NOLINT
+    void append(long long v) noexcept
+    {
+      char digits[24], *p = digits + sizeof(digits);
+      // Negate as unsigned, which is defined for the most negative value
+      unsigned long long u = (v < 0) ? (0 - static_cast<unsigned long long>(v)) : static_cast<unsigned long long>(v);
+      do
+      {
+        *--p = static_cast<char>('0' + (u % 10));
+        u /= 10;
+      } while(u != 0);
+      if(v < 0)
+      {
+        *--p = '-';
+      }
+      append(p, static_cast<size_t>(digits + sizeof(digits) - p));
+    }
+    //! Null terminates, returning the untruncated length
+    size_t finish() noexcept
+    {
+      if(_bytes > 0)
+      {
+        _buffer[(_length < _bytes) ? _length : _bytes - 1] = 0;
+      }
+      return _length;
+    }
+  };
+
+  template <class StatusCode, class Allocator> class indirecting_domain;
+  class provenance_domain;
+  struct wire_codec;
   template <class T> struct status_code_sizer
   {
     void *a;
@@ -57,6 +113,9 @@ namespace detail
     static constexpr bool value = traits::is_move_bitcopying<From>::value  //
                                   && (sizeof(status_code_sizer<From>) <= sizeof(status_code_sizer<To>));
   };
+  // The value of a status code as an integer for diagnostics, or zero if it would not erase into one
+  template <class T, typename std::enable_if<type_erasure_is_safe<intptr_t, T>::value, bool>::type = true> inline intptr_t diagnostic_value(const T &v) noexcept { return erasure_cast<intptr_t>(v); }
+  template <class T, typename std::enable_if<!type_erasure_is_safe<intptr_t, T>::value, bool>::type = true> inline intptr_t diagnostic_value(const T & /*unused*/) noexcept { return 0; }
   /* We are severely limited by needing to retain C++ 11 compatibility when doing
   constexpr string parsing. MSVC lets you throw exceptions within a constexpr
   evaluation context when exceptions are globally disabled, but won't let you
@@ -89,6 +148,13 @@ namespace detail
 #endif
   static constexpr unsigned long long test_uuid_parse = parse_uuid("430f1201-94fc-06c7-430f-120194fc06c7");
   //static constexpr unsigned long long test_uuid_parse2 = parse_uuid("x30f1201-94fc-06c7-430f-120194fc06c7");
+
+  // A cheap, unique identifier for the calling thread
+  inline const void *this_thread_tag() noexcept
+  {
+    static thread_local const char tag{};
+    return &tag;
+  }
 }  // namespace detail
 
 /*! Abstract base class for a coding domain of a status code.
@@ -96,11 +162,51 @@ namespace detail
 class status_code_domain
 {
   template <class DomainType> friend class status_code;
-  template <class StatusCode> friend class indirecting_domain;
+  template <class StatusCode, class Allocator> friend class detail::indirecting_domain;
+  friend class detail::provenance_domain;
+  template <class Base, size_t Slots> friend class cached_message_domain;
 
 public:
   //! Type of the unique id for this domain.
   using unique_id_type = unsigned long long;
+  /*! A non-owning view of a null terminated message string which lives for the whole life of the
+  process, such as one in an immutable table. Trivially copyable, and its length is never measured
+  at runtime. A default constructed view has a null `data()`, meaning there is no such string.
+  */
+  class message_view_type
+  {
+    const char *_begin{nullptr};
+    size_t _size{0};
+
+  public:
+    //! Default construction to no string
+    constexpr message_view_type() noexcept {}  // NOLINT
+    //! Construct from a null terminated string of length `len`, which must live for the life of the process.
+    constexpr message_view_type(const char *str, size_t len) noexcept
+        : _begin(str)
+        , _size(len)
+    {
+    }
+    //! Construct from a string literal.
+    template <size_t N>
+    constexpr message_view_type(const char (&str)[N]) noexcept  // NOLINT
+        : _begin(str)
+        , _size(N - 1)
+    {
+    }
+    //! The string, which is null terminated, or null if there is none.
+    constexpr const char *data() const noexcept { return _begin; }
+    //! The string, which is null terminated, or null if there is none.
+    constexpr const char *c_str() const noexcept { return _begin; }
+    //! The length of the string.
+    constexpr size_t size() const noexcept { return _size; }
+    //! True if the string is empty, or there is none.
+    constexpr bool empty() const noexcept { return _size == 0; }
+    //! The beginning of the string.
+    constexpr const char *begin() const noexcept { return _begin; }
+    //! The end of the string.
+    constexpr const char *end() const noexcept { return _begin + _size; }
+  };
   /*! (Potentially thread safe) Reference to a message string.
 
   Be aware that you cannot add payload to implementations of this class.
@@ -337,23 +443,292 @@ public:
     }
   };
 
+  /*! An allocator for message strings, in the form of C function pointers so it may be
+  passed across ABI boundaries. `deallocate` is called with the same `context` and `bytes`
+  as the corresponding `allocate`. `allocate` returns null on failure, and the memory it
+  returns must be suitably aligned for a pointer.
+  */
+  struct string_allocator
+  {
+    void *(*allocate)(void *context, size_t bytes);
+    void (*deallocate)(void *context, void *p, size_t bytes);
+    void *context;
+
+    //! An allocator using `malloc()` and `free()`.
+    static constexpr string_allocator malloc_allocator() noexcept { return string_allocator{_malloc, _free, nullptr}; }
+
+  private:
+    static void *_malloc(void * /*unused*/, size_t bytes) { return malloc(bytes); }  // NOLINT
+    static void _free(void * /*unused*/, void *p, size_t /*unused*/) { free(p); }    // NOLINT
+  };
+
+  /*! A reference counted, threadsafe reference to a message string, where the reference
+  count and a copy of the string live in a single block from a `string_allocator`.
+  */
+  class atomic_refcounted_block_string_ref : public string_ref
+  {
+    struct _block
+    {
+      mutable std::atomic<unsigned> count{1};
+      size_t bytes;
+      void (*deallocate)(void *context, void *p, size_t bytes);
+      void *context;
+      // The characters follow
+      char *chars() noexcept { return reinterpret_cast<char *>(this + 1); }  // NOLINT
+    };
+    _block *&_blk() noexcept { return reinterpret_cast<_block *&>(this->_state[0]); }                  // NOLINT
+    const _block *_blk() const noexcept { return reinterpret_cast<const _block *>(this->_state[0]); }  // NOLINT
+
+    static _block *_make_block(const char *str, size_type len, const string_allocator &alloc) noexcept
+    {
+      const size_t bytes = sizeof(_block) + len + 1;
+      void *p = alloc.allocate(alloc.context, bytes);
+      if(p == nullptr)
+      {
+        return nullptr;
+      }
+      auto *b = new(p) _block;
+      b->bytes = bytes;
+      b->deallocate = alloc.deallocate;
+      b->context = alloc.context;
+      memcpy(b->chars(), str, len);  // NOLINT
+      b->chars()[len] = 0;
+      return b;
+    }
+
+    static void _refcounted_block_string_thunk(string_ref *_dest, const string_ref *_src, _thunk_op op) noexcept
+    {
+      auto dest = static_cast<atomic_refcounted_block_string_ref *>(_dest);      // NOLINT
+      auto src = static_cast<const atomic_refcounted_block_string_ref *>(_src);  // NOLINT
+      (void) src;
+      assert(dest->_thunk == _refcounted_block_string_thunk);                   // NOLINT
+      assert(src == nullptr || src->_thunk == _refcounted_block_string_thunk);  // NOLINT
+      switch(op)
+      {
+      case _thunk_op::copy:
+      {
+        if(dest->_blk() != nullptr)
+        {
+          auto count = dest->_blk()->count.fetch_add(1, std::memory_order_relaxed);
+          (void) count;
+          assert(count != 0);  // NOLINT
+        }
+        return;
+      }
+      case _thunk_op::move:
+      {
+        assert(src);                                                        // NOLINT
+        auto msrc = const_cast<atomic_refcounted_block_string_ref *>(src);  // NOLINT
+        msrc->_begin = msrc->_end = nullptr;
+        msrc->_state[0] = msrc->_state[1] = msrc->_state[2] = nullptr;
+        return;
+      }
+      case _thunk_op::destruct:
+      {
+        _block *b = dest->_blk();
+        if(b != nullptr && b->count.fetch_sub(1, std::memory_order_release) == 1)
+        {
+          std::atomic_thread_fence(std::memory_order_acquire);
+          auto deallocate = b->deallocate;
+          void *context = b->context;
+          size_t bytes = b->bytes;
+          b->~_block();
+          deallocate(context, b, bytes);
+        }
+      }
+      }
+    }
+
+    atomic_refcounted_block_string_ref(_block *b, size_type len) noexcept
+        : string_ref((b != nullptr) ? b->chars() : "failed to get message from system", (b != nullptr) ? len : static_cast<size_type>(-1), b, nullptr, nullptr, (b != nullptr) ? _refcounted_block_string_thunk : nullptr)
+    {
+    }
+    atomic_refcounted_block_string_ref(const char *str, size_type len, const string_allocator &alloc, std::true_type /*length is known*/) noexcept
+        : atomic_refcounted_block_string_ref(_make_block(str, len, alloc), len)
+    {
+    }
+
+  public:
+    //! Construct from a copy of `len` characters of `str`, allocated using `alloc`.
+    explicit atomic_refcounted_block_string_ref(const char *str, size_type len = static_cast<size_type>(-1), const string_allocator &alloc = string_allocator::malloc_allocator()) noexcept
+        : atomic_refcounted_block_string_ref(str, (len == static_cast<size_type>(-1)) ? strlen(str) : len, alloc, std::true_type())
+    {
+    }
+  };
+
+  /*! A reference counted, threadsafe reference to a message string, whose reference
+  count is biased towards the thread which created it.
+
+  The reference count is split into two counters on separate cache lines. References
+  made by the owning thread are counted by an owner counter which only the owning thread
+  modifies, unless such a reference is later released on another thread. References made by
+  all other threads are counted by a shared counter. Whilst the owner counter is non-zero,
+  it holds a single reference on the shared counter. This means a string whose references
+  are copied and released by many threads at once does not bounce a single cache line
+  between all of them. The owning thread's own copies and releases are also uncontended.
+
+  Like `atomic_refcounted_block_string_ref`, the counters and a copy of the string live in
+  a single block from a `string_allocator`.
+  */
+  class biased_refcounted_string_ref : public string_ref
+  {
+    struct _block
+    {
+      // Only modified by the owning thread, except when its references are released by another thread
+      std::atomic<unsigned> owner_count{1};
+      const void *owner;
+      char _padding[64 - sizeof(std::atomic<unsigned>) - sizeof(void *)];
+      // Modified by every other thread. Holds one reference on behalf of the owner counter whilst it is non-zero.
+      std::atomic<unsigned> shared_count{1};
+      size_t bytes;
+      void (*deallocate)(void *context, void *p, size_t bytes);
+      void *context;
+      // The characters follow
+      char *chars() noexcept { return reinterpret_cast<char *>(this + 1); }  // NOLINT
+    };
+    _block *&_blk() noexcept { return reinterpret_cast<_block *&>(this->_state[0]); }                  // NOLINT
+    const _block *_blk() const noexcept { return reinterpret_cast<const _block *>(this->_state[0]); }  // NOLINT
+    // Non-null if this reference is counted by the owner counter
+    void *&_owned() noexcept { return this->_state[1]; }
+
+    static _block *_make_block(const char *str, size_type len, const string_allocator &alloc) noexcept
+    {
+      const size_t bytes = sizeof(_block) + len + 1;
+      void *p = alloc.allocate(alloc.context, bytes);
+      if(p == nullptr)
+      {
+        return nullptr;
+      }
+      auto *b = new(p) _block;
+      b->owner = detail::this_thread_tag();
+      b->bytes = bytes;
+      b->deallocate = alloc.deallocate;
+      b->context = alloc.context;
+      memcpy(b->chars(), str, len);  // NOLINT
+      b->chars()[len] = 0;
+      return b;
+    }
+
+    static void _release_shared(_block *b) noexcept
+    {
+      if(b->shared_count.fetch_sub(1, std::memory_order_release) == 1)
+      {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        auto deallocate = b->deallocate;
+        void *context = b->context;
+        size_t bytes = b->bytes;
+        b->~_block();
+        deallocate(context, b, bytes);
+      }
+    }
+
+    static void _biased_refcounted_string_thunk(string_ref *_dest, const string_ref *_src, _thunk_op op) noexcept
+    {
+      auto dest = static_cast<biased_refcounted_string_ref *>(_dest);      // NOLINT
+      auto src = static_cast<const biased_refcounted_string_ref *>(_src);  // NOLINT
+      (void) src;
+      assert(dest->_thunk == _biased_refcounted_string_thunk);                   // NOLINT
+      assert(src == nullptr || src->_thunk == _biased_refcounted_string_thunk);  // NOLINT
+      switch(op)
+      {
+      case _thunk_op::copy:
+      {
+        _block *b = dest->_blk();
+        if(b == nullptr)
+        {
+          return;
+        }
+        if(b->owner == detail::this_thread_tag())
+        {
+          // The source reference keeps the block alive, so if the owner counter was zero
+          // it is safe to take back its reference on the shared counter afterwards
+          if(b->owner_count.fetch_add(1, std::memory_order_relaxed) == 0)
+          {
+            b->shared_count.fetch_add(1, std::memory_order_relaxed);
+          }
+          dest->_owned() = b;
+        }
+        else
+        {
+          auto count = b->shared_count.fetch_add(1, std::memory_order_relaxed);
+          (void) count;
+          assert(count != 0);  // NOLINT
+          dest->_owned() = nullptr;
+        }
+        return;
+      }
+      case _thunk_op::move:
+      {
+        assert(src);                                                  // NOLINT
+        auto msrc = const_cast<biased_refcounted_string_ref *>(src);  // NOLINT
+        msrc->_begin = msrc->_end = nullptr;
+        msrc->_state[0] = msrc->_state[1] = msrc->_state[2] = nullptr;
+        return;
+      }
+      case _thunk_op::destruct:
+      {
+        _block *b = dest->_blk();
+        if(b == nullptr)
+        {
+          return;
+        }
+        if(dest->_owned() != nullptr)
+        {
+          if(b->owner_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+          {
+            _release_shared(b);
+          }
+        }
+        else
+        {
+          _release_shared(b);
+        }
+      }
+      }
+    }
+
+    biased_refcounted_string_ref(_block *b, size_type len) noexcept
+        : string_ref((b != nullptr) ? b->chars() : "failed to get message from system", (b != nullptr) ? len : static_cast<size_type>(-1), b, b, nullptr, (b != nullptr) ? _biased_refcounted_string_thunk : nullptr)
+    {
+    }
+    biased_refcounted_string_ref(const char *str, size_type len, const string_allocator &alloc, std::true_type /*length is known*/) noexcept
+        : biased_refcounted_string_ref(_make_block(str, len, alloc), len)
+    {
+    }
+
+  public:
+    //! Construct from a copy of `len` characters of `str`, allocated using `alloc`. The calling thread becomes the owner.
+    explicit biased_refcounted_string_ref(const char *str, size_type len = static_cast<size_type>(-1), const string_allocator &alloc = string_allocator::malloc_allocator()) noexcept
+        : biased_refcounted_string_ref(str, (len == static_cast<size_type>(-1)) ? strlen(str) : len, alloc, std::true_type())
+    {
+    }
+  };
+
 private:
   unique_id_type _id;
+  // Changes the layout from before, see the Readme on ABI
+  bool _value_equality{false};
 
 protected:
   /*! Use [https://www.random.org/cgi-bin/randbyte?nbytes=8&format=h](https://www.random.org/cgi-bin/randbyte?nbytes=8&format=h) to get a random 64 bit id.
 
   Do NOT make up your own value. Do NOT use zero.
+
+  Set `value_equality` only if two codes of this domain are `equivalent()` if and only if
+  their values are bitwise identical, including after each is mapped to a generic code.
+  Equivalence of erased codes of this domain is then decided without consulting the domain.
   */
-  constexpr explicit status_code_domain(unique_id_type id) noexcept
+  constexpr explicit status_code_domain(unique_id_type id, bool value_equality = false) noexcept
       : _id(id)
+      , _value_equality(value_equality)
   {
   }
   /*! UUID constructor, where input is constexpr parsed into a `unique_id_type`.
    */
   template <size_t N>
-  constexpr explicit status_code_domain(const char (&uuid)[N]) noexcept
+  constexpr explicit status_code_domain(const char (&uuid)[N], bool value_equality = false) noexcept
       : _id(detail::parse_uuid<N>(uuid))
+      , _value_equality(value_equality)
   {
   }
   //! No public copying at type erased level
@@ -377,6 +752,8 @@ public:
 
   //! Returns the unique id used to identify identical category instances.
   constexpr unique_id_type id() const noexcept { return _id; }
+  //! True if two codes of this domain are equivalent if and only if their values are equal.
+  constexpr bool equivalence_is_value_equality() const noexcept { return _value_equality; }
   //! Name of this category.
   virtual string_ref name() const noexcept = 0;
 
@@ -404,6 +781,31 @@ protected:
     (void) code;
     (void) bytes;
   }
+  /*! Write a string textually representing a code into `buffer` of `bytes` bytes, truncated and null terminated,
+  returning its untruncated length. Default implementation copies from `_do_message()`, so may allocate and lock.
+  Overrides must do neither, so the message can be formatted from within a signal handler.
+  */
+  virtual size_t _do_format_message(const status_code<void> &code, char *buffer, size_t bytes) const noexcept  // NOLINT
+  {
+    detail::message_writer w(buffer, bytes);
+    const message_view_type view = _do_message_view(code);
+    if(view.data() != nullptr)
+    {
+      w.append(view.data(), view.size());
+      return w.finish();
+    }
+    const string_ref msg = _do_message(code);
+    w.append(msg.data(), msg.size());
+    return w.finish();
+  }
+  /*! Return a view of a string textually representing a code, if the domain keeps its messages in an
+  immutable table for the life of the process. Default implementation returns a view of no string.
+  */
+  virtual message_view_type _do_message_view(const status_code<void> &code) const noexcept  // NOLINT
+  {
+    (void) code;
+    return {};
+  }
 };
 
 SYSTEM_ERROR2_NAMESPACE_END
@@ -0,0 +1,420 @@
+/* Open addressing hash map keyed by status codes
+(C) 2026 agent <agent@local> (2 commits)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef SYSTEM_ERROR2_STATUS_CODE_FLAT_MAP_HPP
+#define SYSTEM_ERROR2_STATUS_CODE_FLAT_MAP_HPP
+
+#include "status_code.hpp"
+
+#include <cstddef>  // for max_align_t
+#include <iterator>
+#include <new>
+#include <tuple>  // for forward_as_tuple
+#include <utility>  // for pair
+
+SYSTEM_ERROR2_NAMESPACE_BEGIN
+
+/*! An unordered map from status codes to `T`, keyed by exact rather than semantic comparison,
+intended for counting and attributing failures at high rates, for example histograms of errors.
+
+Items are stored inline in a single power of two sized array probed linearly, alongside an array
+of one byte per slot holding seven bits of each item's hash, so most lookups touch one cache line
+of the byte array and one item. Erasure shifts following items backwards rather than leaving
+tombstones, so lookups never slow down as items come and go.
+
+As with `std::unordered_map`, `value_type` is a `std::pair<key_type, mapped_type>`. Unlike it, any
+insertion or erasure invalidates all iterators, pointers and references to items, as items move.
+Keys must not be modified through iterators. Keys passed by lvalue are copied with `.clone()`, so
+erased status codes can be used as keys, though keys passed by rvalue are moved instead.
+*/
+template <class StatusCode, class T, class Hash = exact_hash, class KeyEqual = exact_equal> class status_code_flat_map
+{
+public:
+  //! The type of the key
+  using key_type = StatusCode;
+  //! The type of the mapped value
+  using mapped_type = T;
+  //! The type of an item
+  using value_type = std::pair<StatusCode, T>;
+  //! The type of sizes
+  using size_type = size_t;
+  //! The hash function
+  using hasher = Hash;
+  //! The key equality function
+  using key_equal = KeyEqual;
+
+private:
+  static_assert(alignof(value_type) <= alignof(std::max_align_t), "status_code_flat_map does not support over aligned items");
+  // A control byte is zero if its slot is empty, otherwise the top bit set with the top seven bits of the hash
+  static constexpr unsigned char _empty = 0;
+  static constexpr size_type _min_capacity = 8;
+
+  value_type *_slots{nullptr};
+  unsigned char *_ctrl{nullptr};
+  size_type _mask{0};  // capacity minus one, or zero if there is no storage
+  size_type _size{0};
+  hasher _hash;
+  key_equal _equal;
+
+  static unsigned char _fingerprint(size_t h) noexcept { return static_cast<unsigned char>(0x80U | (h >> (sizeof(size_t) * 8 - 7))); }
+  size_type _capacity() const noexcept { return (_slots == nullptr) ? 0 : _mask + 1; }
+  // Keep the load factor at or below seven eighths
+  static size_type _capacity_for(size_type n) noexcept
+  {
+    size_type cap = _min_capacity;
+    while(cap - cap / 8 < n)
+    {
+      cap <<= 1U;
+    }
+    return cap;
+  }
+
+  template <class K> size_type _find(const K &k, size_t h) const noexcept
+  {
+    if(_slots == nullptr)
+    {
+      return size_type(-1);
+    }
+    const unsigned char fp = _fingerprint(h);
+    for(size_type idx = h & _mask;; idx = (idx + 1) & _mask)
+    {
+      if(_ctrl[idx] == _empty)
+      {
+        return size_type(-1);
+      }
+      if(_ctrl[idx] == fp && _equal(_slots[idx].first, k))
+      {
+        return idx;
+      }
+    }
+  }
+  // Returns the empty slot in which an item with hash `h` would go, which must exist
+  size_type _find_empty(size_t h) const noexcept
+  {
+    size_type idx = h & _mask;
+    while(_ctrl[idx] != _empty)
+    {
+      idx = (idx + 1) & _mask;
+    }
+    return idx;
+  }
+  void _rehash(size_type cap)
+  {
+    auto *mem = static_cast<unsigned char *>(::operator new(cap * sizeof(value_type) + cap));
+    auto *slots = reinterpret_cast<value_type *>(mem);  // NOLINT
+    unsigned char *ctrl = mem + cap * sizeof(value_type);
+    memset(ctrl, _empty, cap);
+    value_type *oldslots = _slots;
+    unsigned char *oldctrl = _ctrl;
+    const size_type oldcap = _capacity();
+    _slots = slots;
+    _ctrl = ctrl;
+    _mask = cap - 1;
+    for(size_type n = 0; n < oldcap; n++)
+    {
+      if(oldctrl[n] != _empty)
+      {
+        const size_t h = _hash(oldslots[n].first);
+        const size_type idx = _find_empty(h);
+        new(&_slots[idx]) value_type(static_cast<value_type &&>(oldslots[n]));
+        _ctrl[idx] = _fingerprint(h);
+        oldslots[n].~value_type();
+      }
+    }
+    ::operator delete(oldslots);
+  }
+  // Returns the slot for the key, inserting an item constructed from `args` if it is not present
+  template <class K, class... Args> std::pair<size_type, bool> _try_emplace(K &&k, Args &&... args)
+  {
+    size_t h = _hash(k);
+    size_type idx = _find(k, h);
+    if(idx != size_type(-1))
+    {
+      return {idx, false};
+    }
+    if(_size + 1 > _capacity() - _capacity() / 8)
+    {
+      _rehash(_capacity_for(_size + 1));
+    }
+    idx = _find_empty(h);
+    new(&_slots[idx]) value_type(std::piecewise_construct, std::forward_as_tuple(_copy_key(static_cast<K &&>(k))), std::forward_as_tuple(static_cast<Args &&>(args)...));
+    _ctrl[idx] = _fingerprint(h);
+    ++_size;
+    return {idx, true};
+  }
+  static key_type _copy_key(const key_type &k) { return k.clone(); }
+  static key_type &&_copy_key(key_type &&k) noexcept { return static_cast<key_type &&>(k); }
+  void _erase_at(size_type idx) noexcept
+  {
+    _slots[idx].~value_type();
+    _ctrl[idx] = _empty;
+    --_size;
+    // Shift back any following items which are displaced from their home slot past the hole
+    for(size_type j = (idx + 1) & _mask; _ctrl[j] != _empty; j = (j + 1) & _mask)
+    {
+      const size_type home = _hash(_slots[j].first) & _mask;
+      if(((j - home) & _mask) >= ((j - idx) & _mask))
+      {
+        new(&_slots[idx]) value_type(static_cast<value_type &&>(_slots[j]));
+        _ctrl[idx] = _ctrl[j];
+        _slots[j].~value_type();
+        _ctrl[j] = _empty;
+        idx = j;
+      }
+    }
+  }
+
+  template <class V> class _iterator
+  {
+    friend class status_code_flat_map;
+    V *_slots{nullptr};
+    const unsigned char *_ctrl{nullptr};
+    size_type _idx{0}, _end{0};
+
+    _iterator(V *slots, const unsigned char *ctrl, size_type idx, size_type end) noexcept
+        : _slots(slots)
+        , _ctrl(ctrl)
+        , _idx(idx)
+        , _end(end)
+    {
+      _skip();
+    }
+    void _skip() noexcept
+    {
+      while(_idx < _end && _ctrl[_idx] == _empty)
+      {
+        ++_idx;
+      }
+    }
+
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = typename std::remove_const<V>::type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = V *;
+    using reference = V &;
+
+    _iterator() = default;
+    //! Implicit conversion from iterator to const_iterator
+    template <class U, typename std::enable_if<std::is_convertible<U *, V *>::value, bool>::type = true>  //
+    _iterator(const _iterator<U> &o) noexcept                                                            // NOLINT
+        : _slots(o._slots)
+        , _ctrl(o._ctrl)
+        , _idx(o._idx)
+        , _end(o._end)
+    {
+    }
+    reference operator*() const noexcept { return _slots[_idx]; }
+    pointer operator->() const noexcept { return &_slots[_idx]; }
+    _iterator &operator++() noexcept
+    {
+      ++_idx;
+      _skip();
+      return *this;
+    }
+    _iterator operator++(int) noexcept
+    {
+      _iterator ret(*this);
+      ++*this;
+      return ret;
+    }
+    bool operator==(const _iterator &o) const noexcept { return _idx == o._idx; }
+    bool operator!=(const _iterator &o) const noexcept { return _idx != o._idx; }
+
+    template <class U> friend class _iterator;
+  };
+
+public:
+  //! The type of an iterator
+  using iterator = _iterator<value_type>;
+  //! The type of a const iterator
+  using const_iterator = _iterator<const value_type>;
+
+  //! Default construction, which does not allocate
+  status_code_flat_map() = default;
+  //! Constructs with room for `n` items without rehashing
+  explicit status_code_flat_map(size_type n, const hasher &hash = hasher(), const key_equal &equal = key_equal())
+      : _hash(hash)
+      , _equal(equal)
+  {
+    reserve(n);
+  }
+  //! Copy construction, copying keys with `.clone()`
+  status_code_flat_map(const status_code_flat_map &o)
+      : _hash(o._hash)
+      , _equal(o._equal)
+  {
+    reserve(o._size);
+    for(const auto &i : o)
+    {
+      _try_emplace(i.first, i.second);
+    }
+  }
+  //! Move construction, which does not move items
+  status_code_flat_map(status_code_flat_map &&o) noexcept
+      : _slots(o._slots)
+      , _ctrl(o._ctrl)
+      , _mask(o._mask)
+      , _size(o._size)
+      , _hash(static_cast<hasher &&>(o._hash))
+      , _equal(static_cast<key_equal &&>(o._equal))
+  {
+    o._slots = nullptr;
+    o._ctrl = nullptr;
+    o._mask = 0;
+    o._size = 0;
+  }
+  //! Copy assignment
+  status_code_flat_map &operator=(const status_code_flat_map &o)
+  {
+    if(this != &o)
+    {
+      status_code_flat_map temp(o);
+      this->~status_code_flat_map();
+      new(this) status_code_flat_map(static_cast<status_code_flat_map &&>(temp));
+    }
+    return *this;
+  }
+  //! Move assignment
+  status_code_flat_map &operator=(status_code_flat_map &&o) noexcept
+  {
+    if(this != &o)
+    {
+      this->~status_code_flat_map();
+      new(this) status_code_flat_map(static_cast<status_code_flat_map &&>(o));
+    }
+    return *this;
+  }
+  ~status_code_flat_map()
+  {
+    clear();
+    ::operator delete(_slots);
+  }
+
+  //! True if the map is empty
+  bool empty() const noexcept { return _size == 0; }
+  //! The number of items in the map
+  size_type size() const noexcept { return _size; }
+  //! The number of items the map can hold before it must rehash
+  size_type capacity() const noexcept { return _capacity() - _capacity() / 8; }
+
+  //! Destroys all items, keeping the storage
+  void clear() noexcept
+  {
+    for(size_type n = 0; n < _capacity() && _size > 0; n++)
+    {
+      if(_ctrl[n] != _empty)
+      {
+        _slots[n].~value_type();
+        _ctrl[n] = _empty;
+        --_size;
+      }
+    }
+  }
+  //! Ensures the map can hold `n` items without rehashing
+  void reserve(size_type n)
+  {
+    if(n > capacity())
+    {
+      _rehash(_capacity_for(n));
+    }
+  }
+
+  //! Returns an iterator to the first item
+  iterator begin() noexcept { return iterator(_slots, _ctrl, 0, _capacity()); }
+  //! Returns an iterator to the first item
+  const_iterator begin() const noexcept { return const_iterator(_slots, _ctrl, 0, _capacity()); }
+  //! Returns an iterator to the first item
+  const_iterator cbegin() const noexcept { return begin(); }
+  //! Returns an iterator past the last item
+  iterator end() noexcept { return iterator(_slots, _ctrl, _capacity(), _capacity()); }
+  //! Returns an iterator past the last item
+  const_iterator end() const noexcept { return const_iterator(_slots, _ctrl, _capacity(), _capacity()); }
+  //! Returns an iterator past the last item
+  const_iterator cend() const noexcept { return end(); }
+
+  //! Returns an iterator to the item with key `k`, or `end()`
+  iterator find(const key_type &k) noexcept
+  {
+    const size_type idx = _find(k, _hash(k));
+    return (idx == size_type(-1)) ? end() : iterator(_slots, _ctrl, idx, _capacity());
+  }
+  //! Returns an iterator to the item with key `k`, or `end()`
+  const_iterator find(const key_type &k) const noexcept
+  {
+    const size_type idx = _find(k, _hash(k));
+    return (idx == size_type(-1)) ? end() : const_iterator(_slots, _ctrl, idx, _capacity());
+  }
+  //! Returns the number of items with key `k`, which is zero or one
+  size_type count(const key_type &k) const noexcept { return (_find(k, _hash(k)) == size_type(-1)) ? 0 : 1; }
+  //! True if there is an item with key `k`
+  bool contains(const key_type &k) const noexcept { return count(k) != 0; }
+
+  //! Returns the mapped value for key `k`, inserting a value initialised one if it is not present
+  mapped_type &operator[](const key_type &k)
+  {
+    // Inserting may reallocate the slots, so index them only afterwards
+    const size_type idx = _try_emplace(k).first;
+    return _slots[idx].second;
+  }
+  //! Returns the mapped value for key `k`, inserting a value initialised one if it is not present
+  mapped_type &operator[](key_type &&k)
+  {
+    const size_type idx = _try_emplace(static_cast<key_type &&>(k)).first;
+    return _slots[idx].second;
+  }
+
+  //! If key `k` is not present, inserts an item with a mapped value constructed from `args`. Returns the item, and whether it was inserted.
+  template <class... Args> std::pair<iterator, bool> try_emplace(const key_type &k, Args &&... args)
+  {
+    const auto r = _try_emplace(k, static_cast<Args &&>(args)...);
+    return {iterator(_slots, _ctrl, r.first, _capacity()), r.second};
+  }
+  //! If key `k` is not present, inserts an item with a mapped value constructed from `args`. Returns the item, and whether it was inserted.
+  template <class... Args> std::pair<iterator, bool> try_emplace(key_type &&k, Args &&... args)
+  {
+    const auto r = _try_emplace(static_cast<key_type &&>(k), static_cast<Args &&>(args)...);
+    return {iterator(_slots, _ctrl, r.first, _capacity()), r.second};
+  }
+  //! Inserts `v` if its key is not present. Returns the item, and whether it was inserted.
+  std::pair<iterator, bool> insert(value_type &&v) { return try_emplace(static_cast<key_type &&>(v.first), static_cast<mapped_type &&>(v.second)); }
+
+  //! Erases the item with key `k`, returning the number of items erased
+  size_type erase(const key_type &k) noexcept
+  {
+    const size_type idx = _find(k, _hash(k));
+    if(idx == size_type(-1))
+    {
+      return 0;
+    }
+    _erase_at(idx);
+    return 1;
+  }
+  //! Erases the item at `it`. As items move, unlike `std::unordered_map` this does not return the next item.
+  void erase(const_iterator it) noexcept { _erase_at(it._idx); }
+};
+
+SYSTEM_ERROR2_NAMESPACE_END
+
+#endif
@@ -27,21 +27,323 @@ http://www.boost.org/LICENSE_1_0.txt)
 
 #include "status_code.hpp"
 
+#include <cstdint>
+#include <memory>
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+#endif
+
 SYSTEM_ERROR2_NAMESPACE_BEGIN
 
 namespace detail
 {
-  template <class StatusCode> class indirecting_domain : public status_code_domain
+#ifndef SYSTEM_ERROR2_STATUS_CODE_PTR_THREAD_CACHE
+//! The maximum number of free blocks of each size which each thread keeps for reuse.
+#define SYSTEM_ERROR2_STATUS_CODE_PTR_THREAD_CACHE 32
+#endif
+#ifndef SYSTEM_ERROR2_STATUS_CODE_PTR_RESERVE
+//! The number of blocks of each size set aside statically for use when the free store is exhausted. At most 64.
+#define SYSTEM_ERROR2_STATUS_CODE_PTR_RESERVE 16
+#endif
+  static_assert(SYSTEM_ERROR2_STATUS_CODE_PTR_RESERVE <= 64, "SYSTEM_ERROR2_STATUS_CODE_PTR_RESERVE must not exceed 64");
+
+  /* A pool of fixed size blocks. Each thread keeps a small free list of blocks
+  it has released, so steady state allocation and deallocation touches neither
+  the free store nor any shared cache line. Only when the free store fails
+  do we claim a block from a statically allocated reserve, which is returned
+  to the reserve upon deallocation.
+  */
+  template <size_t Bytes, size_t Align> class status_code_ptr_pool
+  {
+    union _block {
+      _block *next;
+      alignas(Align) char storage[Bytes];
+    };
+    static_assert(alignof(_block) <= alignof(std::max_align_t), "over aligned status codes are not supported by the pool");
+
+    // Trivially destructible, so it remains usable by thread_local destructors which run after the drainer
+    struct _thread_cache
+    {
+      _block *head;
+      size_t count;
+      bool registered, dead;
+    };
+    static _thread_cache &_cache() noexcept
+    {
+      static thread_local _thread_cache v;
+      return v;
+    }
+    struct _drainer
+    {
+      _drainer() = default;
+      _drainer(const _drainer &) = delete;
+      _drainer(_drainer &&) = delete;
+      _drainer &operator=(const _drainer &) = delete;
+      _drainer &operator=(_drainer &&) = delete;
+      ~_drainer()
+      {
+        auto &c = _cache();
+        c.dead = true;
+        while(c.head != nullptr)
+        {
+          _block *n = c.head->next;
+          _release(c.head);
+          c.head = n;
+        }
+        c.count = 0;
+      }
+    };
+
+    struct _reserve_type
+    {
+      _block blocks[SYSTEM_ERROR2_STATUS_CODE_PTR_RESERVE];
+      std::atomic<uint64_t> used;
+    };
+    static _reserve_type &_reserve() noexcept
+    {
+      static _reserve_type v;
+      return v;
+    }
+
+    static bool _is_reserved(const _block *p) noexcept
+    {
+      auto &r = _reserve();
+      return p >= r.blocks && p < r.blocks + SYSTEM_ERROR2_STATUS_CODE_PTR_RESERVE;
+    }
+    static void _release(_block *p) noexcept
+    {
+      if(_is_reserved(p))
+      {
+        auto &r = _reserve();
+        r.used.fetch_and(~(uint64_t(1) << (p - r.blocks)), std::memory_order_release);
+        return;
+      }
+      ::operator delete(p);
+    }
+
+  public:
+    //! Returns a block, or null if both the free store and the emergency reserve are exhausted.
+    static void *allocate() noexcept
+    {
+      auto &c = _cache();
+      if(c.head != nullptr)
+      {
+        _block *p = c.head;
+        c.head = p->next;
+        --c.count;
+        return p;
+      }
+      void *p = ::operator new(sizeof(_block), std::nothrow);
+      if(p != nullptr)
+      {
+        return p;
+      }
+      auto &r = _reserve();
+      uint64_t used = r.used.load(std::memory_order_relaxed);
+      for(;;)
+      {
+        size_t idx = 0;
+        while(idx < SYSTEM_ERROR2_STATUS_CODE_PTR_RESERVE && (used & (uint64_t(1) << idx)) != 0)
+        {
+          ++idx;
+        }
+        if(idx == SYSTEM_ERROR2_STATUS_CODE_PTR_RESERVE)
+        {
+          return nullptr;
+        }
+        if(r.used.compare_exchange_weak(used, used | (uint64_t(1) << idx), std::memory_order_acquire, std::memory_order_relaxed))
+        {
+          return r.blocks + idx;
+        }
+      }
+    }
+    //! Returns a block obtained from `allocate()` from any thread.
+    static void deallocate(void *_p) noexcept
+    {
+      auto *p = static_cast<_block *>(_p);
+      auto &c = _cache();
+      // Blocks from the reserve go straight back to it, lest the next thread to run out of memory find it empty
+      if(!_is_reserved(p) && !c.dead && c.count < SYSTEM_ERROR2_STATUS_CODE_PTR_THREAD_CACHE)
+      {
+        if(!c.registered)
+        {
+          c.registered = true;
+          static thread_local _drainer d;
+          (void) d;
+        }
+        p->next = c.head;
+        c.head = p;
+        ++c.count;
+        return;
+      }
+      _release(p);
+    }
+  };
+}  // namespace detail
+
+/*! The default allocator used by `make_status_code_ptr()`. Single objects come
+from a per-thread cache of fixed size blocks, falling back to a small statically
+allocated reserve if the free store is exhausted, so that constructing a rich
+error code during memory exhaustion does not itself fail. Blocks may be released
+by a different thread to the one which allocated them.
+*/
+template <class T> class status_code_ptr_allocator
+{
+  using _pool = detail::status_code_ptr_pool<sizeof(T), alignof(T)>;
+
+public:
+  //! The type allocated
+  using value_type = T;
+
+  //! Default constructor
+  constexpr status_code_ptr_allocator() noexcept {}  // NOLINT
+  //! Rebinding constructor
+  template <class U> constexpr status_code_ptr_allocator(const status_code_ptr_allocator<U> & /*unused*/) noexcept {}  // NOLINT
+
+  //! Allocates `n` objects of `T`. Fails only if the free store and the emergency reserve are both exhausted.
+  T *allocate(size_t n)
+  {
+    void *p = (n == 1) ? _pool::allocate() : ::operator new(n * sizeof(T), std::nothrow);
+    if(p == nullptr)
+    {
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(STANDARDESE_IS_IN_THE_HOUSE)
+      throw std::bad_alloc();
+#else
+      SYSTEM_ERROR2_FATAL("status_code_ptr_allocator: out of memory");
+#endif
+    }
+    return static_cast<T *>(p);
+  }
+  //! Deallocates `n` objects of `T` previously allocated by any instance.
+  void deallocate(T *p, size_t n) noexcept
+  {
+    if(n == 1)
+    {
+      _pool::deallocate(p);
+    }
+    else
+    {
+      ::operator delete(p);
+    }
+  }
+
+  //! All instances are interchangeable
+  template <class U> constexpr bool operator==(const status_code_ptr_allocator<U> & /*unused*/) const noexcept { return true; }
+  //! All instances are interchangeable
+  template <class U> constexpr bool operator!=(const status_code_ptr_allocator<U> & /*unused*/) const noexcept { return false; }
+};
+
+namespace detail
+{
+  template <class Allocator, class = void> struct status_code_ptr_declared_tag
+  {
+    static_assert(!std::is_same<Allocator, Allocator>::value, "Allocators used with make_status_code_ptr() must declare a status_code_ptr_tag, or specialise traits::status_code_ptr_allocator_tag");
+    static constexpr unsigned value = 64;
+  };
+  template <class Allocator> struct status_code_ptr_declared_tag<Allocator, decltype((void) Allocator::status_code_ptr_tag)>
+  {
+    static constexpr unsigned value = Allocator::status_code_ptr_tag;
+  };
+}  // namespace detail
+
+namespace traits
+{
+  /*! Distinguishes, in the domain ids of status codes made by `make_status_code_ptr()` and
+  `make_shared_status_code_ptr()`, which kind of allocator allocated the indirected status code.
+  `value` must be below 64. Tags below 8 are used by this library. Your own allocators must
+  choose a tag from 8 to 63, either by declaring a `static constexpr unsigned status_code_ptr_tag`
+  member, or by specialising this. Allocators which do neither are rejected at compile time, as
+  no tag derived from the type alone could be relied upon to be both distinct and stable.
+  */
+  template <class Allocator> struct status_code_ptr_allocator_tag : detail::status_code_ptr_declared_tag<Allocator>
+  {
+  };
+  template <class T> struct status_code_ptr_allocator_tag<status_code_ptr_allocator<T>>
+  {
+    static constexpr unsigned value = 0;
+  };
+  template <class T> struct status_code_ptr_allocator_tag<std::allocator<T>>
+  {
+    static constexpr unsigned value = 1;
+  };
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+  template <class T> struct status_code_ptr_allocator_tag<std::pmr::polymorphic_allocator<T>>
+  {
+    static constexpr unsigned value = 2;
+  };
+#endif
+#endif
+}  // namespace traits
+
+namespace detail
+{
+  /* The id of an indirecting domain is the id of the domain indirected to, xored with `base` and
+  with a mix in its lowest eight bits. The mix is the allocator's tag, plus `shared` if copies share
+  the payload. Codes made by `make_status_code_ptr()` without an allocator have no mix, so keep the
+  id they always had. Only the mix differs between allocators and ownerships, so `get_if()` finds the
+  indirected code whichever was used, by ignoring those bits.
+  */
+  struct indirecting_domain_ids
+  {
+    static constexpr unsigned long long base = 0xc44f7bdeb2cc50e9;
+    static constexpr unsigned long long mix_mask = 0xff;
+    // For domains whose payload is shared by copies, rather than copied
+    static constexpr unsigned long long shared = 0x80;
+    template <class Allocator> static constexpr unsigned long long mix() noexcept
+    {
+      static_assert(traits::status_code_ptr_allocator_tag<Allocator>::value < 64, "status_code_ptr_allocator_tag must be below 64");
+      return traits::status_code_ptr_allocator_tag<Allocator>::value;
+    }
+    // True if codes of `domain` may be indirections to codes of the domain with unique id `id`
+    static constexpr bool indirects_to(const status_code_domain &domain, unsigned long long id) noexcept { return ((base ^ domain.id() ^ id) & ~mix_mask) == 0; }
+  };
+
+  /* The base of all indirecting domains, which knows the id of the domain indirected to. Every
+  indirecting domain is also kept in a table of its own, so it can be recognised from its id.
+  */
+  class indirecting_domain_base : public status_code_domain
+  {
+    unique_id_type _indirected;
+
+  protected:
+    constexpr indirecting_domain_base(unique_id_type indirected, unsigned long long mix) noexcept
+        : status_code_domain(indirecting_domain_ids::base ^ indirected ^ mix)
+        , _indirected(indirected)
+    {
+    }
+    indirecting_domain_base(const indirecting_domain_base &) = default;
+    indirecting_domain_base(indirecting_domain_base &&) = default;  // NOLINT
+    indirecting_domain_base &operator=(const indirecting_domain_base &) = default;
+    indirecting_domain_base &operator=(indirecting_domain_base &&) = default;  // NOLINT
+    ~indirecting_domain_base() = default;
+
+  public:
+    //! The id of the domain whose codes this domain's codes indirect to.
+    constexpr unique_id_type indirected_id() const noexcept { return _indirected; }
+    //! The indirecting domain with unique id `id`, or null if there is none, or it has not yet been registered.
+    static const indirecting_domain_base *find(unique_id_type id) noexcept { return static_cast<const indirecting_domain_base *>(domain_registry_find<indirecting_domain_base>(id)); }
+  };
+
+  template <class StatusCode, class Allocator> class indirecting_domain : public indirecting_domain_base
   {
     template <class DomainType> friend class status_code;
-    using _base = status_code_domain;
+    using _base = indirecting_domain_base;
 
   public:
-    using value_type = StatusCode *;
+    // The status code must be first, as `get_if()` treats a pointer to this as a pointer to it
+    struct payload_type
+    {
+      StatusCode sc;
+      Allocator alloc;
+    };
+    using value_type = payload_type *;
     using _base::string_ref;
 
     constexpr indirecting_domain() noexcept
-        : _base(0xc44f7bdeb2cc50e9 ^ typename StatusCode::domain_type().id() /* unique-ish based on domain's unique id */)
+        : indirecting_domain(indirecting_domain_ids::mix<Allocator>())
     {
     }
     indirecting_domain(const indirecting_domain &) = default;
@@ -62,37 +364,212 @@ namespace detail
 
     virtual string_ref name() const noexcept override { return typename StatusCode::domain_type().name(); }  // NOLINT
   protected:
+    // For variants, which mix `mix` into the id as well as the id of the domain indirected to
+    constexpr explicit indirecting_domain(unsigned long long mix) noexcept
+        : _base(typename StatusCode::domain_type().id(), mix)
+    {
+    }
+
+    using _mycode = status_code<indirecting_domain>;
+    using _payload_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<payload_type>;
+    using _payload_traits = std::allocator_traits<_payload_allocator>;
+
+  public:
+    template <class T> static payload_type *_make_payload(const Allocator &alloc, T &&v)
+    {
+      _payload_allocator a(alloc);
+      payload_type *p = _payload_traits::allocate(a, 1);
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(STANDARDESE_IS_IN_THE_HOUSE)
+      try
+      {
+        new(p) payload_type{StatusCode(static_cast<T &&>(v)), alloc};
+      }
+      catch(...)
+      {
+        _payload_traits::deallocate(a, p, 1);
+        throw;
+      }
+#else
+      new(p) payload_type{StatusCode(static_cast<T &&>(v)), alloc};
+#endif
+      return p;
+    }
+
+  protected:
+    virtual bool _do_failure(const status_code<void> &code) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      return typename StatusCode::domain_type()._do_failure(c.value()->sc);
+    }
+    virtual bool _do_equivalent(const status_code<void> &code1, const status_code<void> &code2) const noexcept override  // NOLINT
+    {
+      assert(code1.domain() == *this);
+      const auto &c1 = static_cast<const _mycode &>(code1);  // NOLINT
+      return typename StatusCode::domain_type()._do_equivalent(c1.value()->sc, code2);
+    }
+    virtual generic_code _generic_code(const status_code<void> &code) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      return typename StatusCode::domain_type()._generic_code(c.value()->sc);
+    }
+    virtual string_ref _do_message(const status_code<void> &code) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      return typename StatusCode::domain_type()._do_message(c.value()->sc);
+    }
+    virtual size_t _do_format_message(const status_code<void> &code, char *buffer, size_t bytes) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      return typename StatusCode::domain_type()._do_format_message(c.value()->sc, buffer, bytes);
+    }
+    virtual message_view_type _do_message_view(const status_code<void> &code) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      return typename StatusCode::domain_type()._do_message_view(c.value()->sc);
+    }
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(STANDARDESE_IS_IN_THE_HOUSE)
+    SYSTEM_ERROR2_NORETURN virtual void _do_throw_exception(const status_code<void> &code) const override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      typename StatusCode::domain_type()._do_throw_exception(c.value()->sc);
+    }
+#endif
+    virtual void _do_erased_copy(status_code<void> &dst, const status_code<void> &src, size_t /*unused*/) const override  // NOLINT
+    {
+      // Note that dst will not have its domain set
+      assert(src.domain() == *this);
+      auto &d = static_cast<_mycode &>(dst);               // NOLINT
+      const auto &_s = static_cast<const _mycode &>(src);  // NOLINT
+      const payload_type &s = *_s.value();
+      new(&d) _mycode(in_place, _make_payload(std::allocator_traits<Allocator>::select_on_container_copy_construction(s.alloc), s.sc));
+    }
+    virtual void _do_erased_destroy(status_code<void> &code, size_t /*unused*/) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      auto &c = static_cast<_mycode &>(code);  // NOLINT
+      payload_type *p = c.value();
+      _payload_allocator a(p->alloc);
+      p->~payload_type();
+      _payload_traits::deallocate(a, p, 1);
+    }
+  };
+#if __cplusplus >= 201402L || defined(_MSC_VER)
+  template <class StatusCode, class Allocator> constexpr indirecting_domain<StatusCode, Allocator> _indirecting_domain{};
+  template <class StatusCode, class Allocator> inline constexpr const indirecting_domain<StatusCode, Allocator> &indirecting_domain<StatusCode, Allocator>::get() { return _indirecting_domain<StatusCode, Allocator>; }
+#endif
+
+  /* Indirects to an erased status code, such as `system_code_wide`, forwarding
+  to whatever domain that code has at runtime. As the indirected domain is not known
+  at compile time, the id of this domain is instead derived from the size of the
+  erased value type, along with the allocator.
+  */
+  template <class ErasedType, class Allocator> class indirecting_domain<status_code<erased<ErasedType>>, Allocator> : public indirecting_domain_base
+  {
+    template <class DomainType> friend class status_code;
+    using _base = indirecting_domain_base;
+    using StatusCode = status_code<erased<ErasedType>>;
+
+  public:
+    struct payload_type
+    {
+      StatusCode sc;
+      Allocator alloc;
+    };
+    using value_type = payload_type *;
+    using _base::string_ref;
+
+    constexpr indirecting_domain() noexcept
+        : indirecting_domain(indirecting_domain_ids::mix<Allocator>())
+    {
+    }
+    indirecting_domain(const indirecting_domain &) = default;
+    indirecting_domain(indirecting_domain &&) = default;  // NOLINT
+    indirecting_domain &operator=(const indirecting_domain &) = default;
+    indirecting_domain &operator=(indirecting_domain &&) = default;  // NOLINT
+    ~indirecting_domain() = default;
+
+#if __cplusplus < 201402L && !defined(_MSC_VER)
+    static inline const indirecting_domain &get()
+    {
+      static indirecting_domain v;
+      return v;
+    }
+#else
+    static inline constexpr const indirecting_domain &get();
+#endif
+
+    virtual string_ref name() const noexcept override { return string_ref("indirected erased status code"); }  // NOLINT
+  protected:
+    // For variants, which mix `mix` into the id
+    constexpr explicit indirecting_domain(unsigned long long mix) noexcept
+        : _base(0x2e5b6f0d7a91c348 ^ (sizeof(ErasedType) << 8U), mix)
+    {
+    }
+
     using _mycode = status_code<indirecting_domain>;
+    using _payload_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<payload_type>;
+    using _payload_traits = std::allocator_traits<_payload_allocator>;
+
+  public:
+    template <class T> static payload_type *_make_payload(const Allocator &alloc, T &&v)
+    {
+      _payload_allocator a(alloc);
+      payload_type *p = _payload_traits::allocate(a, 1);
+      new(p) payload_type{StatusCode(static_cast<T &&>(v)), alloc};  // moving an erased status code cannot throw
+      return p;
+    }
+
+  protected:
     virtual bool _do_failure(const status_code<void> &code) const noexcept override  // NOLINT
     {
       assert(code.domain() == *this);
       const auto &c = static_cast<const _mycode &>(code);  // NOLINT
-      return typename StatusCode::domain_type()._do_failure(*c.value());
+      return c.value()->sc.failure();
     }
     virtual bool _do_equivalent(const status_code<void> &code1, const status_code<void> &code2) const noexcept override  // NOLINT
     {
       assert(code1.domain() == *this);
       const auto &c1 = static_cast<const _mycode &>(code1);  // NOLINT
-      return typename StatusCode::domain_type()._do_equivalent(*c1.value(), code2);
+      const StatusCode &sc = c1.value()->sc;
+      return !sc.empty() && sc.domain()._do_equivalent(sc, code2);
     }
     virtual generic_code _generic_code(const status_code<void> &code) const noexcept override  // NOLINT
     {
       assert(code.domain() == *this);
       const auto &c = static_cast<const _mycode &>(code);  // NOLINT
-      return typename StatusCode::domain_type()._generic_code(*c.value());
+      const StatusCode &sc = c.value()->sc;
+      return sc.empty() ? generic_code() : sc.domain()._generic_code(sc);
     }
     virtual string_ref _do_message(const status_code<void> &code) const noexcept override  // NOLINT
     {
       assert(code.domain() == *this);
       const auto &c = static_cast<const _mycode &>(code);  // NOLINT
-      return typename StatusCode::domain_type()._do_message(*c.value());
+      return c.value()->sc.message();
+    }
+    virtual size_t _do_format_message(const status_code<void> &code, char *buffer, size_t bytes) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      return c.value()->sc.format_message_to(buffer, bytes);
+    }
+    virtual message_view_type _do_message_view(const status_code<void> &code) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      const auto &c = static_cast<const _mycode &>(code);  // NOLINT
+      return c.value()->sc.message_view();
     }
 #if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(STANDARDESE_IS_IN_THE_HOUSE)
     SYSTEM_ERROR2_NORETURN virtual void _do_throw_exception(const status_code<void> &code) const override  // NOLINT
     {
       assert(code.domain() == *this);
       const auto &c = static_cast<const _mycode &>(code);  // NOLINT
-      typename StatusCode::domain_type()._do_throw_exception(*c.value());
+      c.value()->sc.throw_exception();
     }
 #endif
     virtual void _do_erased_copy(status_code<void> &dst, const status_code<void> &src, size_t /*unused*/) const override  // NOLINT
@@ -101,32 +578,230 @@ namespace detail
       assert(src.domain() == *this);
       auto &d = static_cast<_mycode &>(dst);               // NOLINT
       const auto &_s = static_cast<const _mycode &>(src);  // NOLINT
-      const StatusCode &s = *_s.value();
-      new(&d) _mycode(in_place, new StatusCode(s));
+      const payload_type &s = *_s.value();
+      new(&d) _mycode(in_place, _make_payload(std::allocator_traits<Allocator>::select_on_container_copy_construction(s.alloc), s.sc.clone()));
+    }
+    virtual void _do_erased_destroy(status_code<void> &code, size_t /*unused*/) const noexcept override  // NOLINT
+    {
+      assert(code.domain() == *this);
+      auto &c = static_cast<_mycode &>(code);  // NOLINT
+      payload_type *p = c.value();
+      _payload_allocator a(p->alloc);
+      p->~payload_type();
+      _payload_traits::deallocate(a, p, 1);
+    }
+  };
+#if __cplusplus >= 201402L || defined(_MSC_VER)
+  template <class ErasedType, class Allocator> inline constexpr const indirecting_domain<status_code<erased<ErasedType>>, Allocator> &indirecting_domain<status_code<erased<ErasedType>>, Allocator>::get() { return _indirecting_domain<status_code<erased<ErasedType>>, Allocator>; }
+#endif
+
+  /* An indirecting domain whose payload carries an intrusive reference count, so
+  erased copy shares the payload rather than copying it. The payload begins with
+  the base domain's payload type, so everything but copy and destroy is inherited.
+  Its id differs from the base domain's, as its payloads are owned differently.
+  */
+  template <class StatusCode, class Allocator> class shared_indirecting_domain : public indirecting_domain<StatusCode, Allocator>
+  {
+    template <class DomainType> friend class status_code;
+    using _base = indirecting_domain<StatusCode, Allocator>;
+
+  public:
+    using typename _base::payload_type;
+    using typename _base::value_type;
+
+    constexpr shared_indirecting_domain() noexcept
+        : _base(indirecting_domain_ids::shared | indirecting_domain_ids::mix<Allocator>())
+    {
+    }
+    shared_indirecting_domain(const shared_indirecting_domain &) = default;
+    shared_indirecting_domain(shared_indirecting_domain &&) = default;  // NOLINT
+    shared_indirecting_domain &operator=(const shared_indirecting_domain &) = default;
+    shared_indirecting_domain &operator=(shared_indirecting_domain &&) = default;  // NOLINT
+    ~shared_indirecting_domain() = default;
+
+#if __cplusplus < 201402L && !defined(_MSC_VER)
+    static inline const shared_indirecting_domain &get()
+    {
+      static shared_indirecting_domain v;
+      return v;
+    }
+#else
+    static inline constexpr const shared_indirecting_domain &get();
+#endif
+
+  protected:
+    using _mycode = status_code<shared_indirecting_domain>;
+    struct _shared_payload : payload_type
+    {
+      mutable std::atomic<size_t> count;
+      template <class T>
+      _shared_payload(T &&v, const Allocator &alloc)
+          : payload_type{StatusCode(static_cast<T &&>(v)), alloc}
+          , count(1)
+      {
+      }
+    };
+    using _payload_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<_shared_payload>;
+    using _payload_traits = std::allocator_traits<_payload_allocator>;
+
+  public:
+    template <class T> static payload_type *_make_payload(const Allocator &alloc, T &&v)
+    {
+      _payload_allocator a(alloc);
+      _shared_payload *p = _payload_traits::allocate(a, 1);
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS) || defined(STANDARDESE_IS_IN_THE_HOUSE)
+      try
+      {
+        new(p) _shared_payload(static_cast<T &&>(v), alloc);
+      }
+      catch(...)
+      {
+        _payload_traits::deallocate(a, p, 1);
+        throw;
+      }
+#else
+      new(p) _shared_payload(static_cast<T &&>(v), alloc);
+#endif
+      return p;
+    }
+
+  protected:
+    virtual void _do_erased_copy(status_code<void> &dst, const status_code<void> &src, size_t /*unused*/) const override  // NOLINT
+    {
+      // Note that dst will not have its domain set
+      assert(src.domain() == *this);
+      auto &d = static_cast<_mycode &>(dst);              // NOLINT
+      const auto &s = static_cast<const _mycode &>(src);  // NOLINT
+      static_cast<_shared_payload *>(s.value())->count.fetch_add(1, std::memory_order_relaxed);
+      new(&d) _mycode(in_place, s.value());
     }
     virtual void _do_erased_destroy(status_code<void> &code, size_t /*unused*/) const noexcept override  // NOLINT
     {
       assert(code.domain() == *this);
       auto &c = static_cast<_mycode &>(code);  // NOLINT
-      delete c.value();                        // NOLINT
+      auto *p = static_cast<_shared_payload *>(c.value());
+      if(p->count.fetch_sub(1, std::memory_order_release) == 1)
+      {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        _payload_allocator a(p->alloc);
+        p->~_shared_payload();
+        _payload_traits::deallocate(a, p, 1);
+      }
     }
   };
 #if __cplusplus >= 201402L || defined(_MSC_VER)
-  template <class StatusCode> constexpr indirecting_domain<StatusCode> _indirecting_domain{};
-  template <class StatusCode> inline constexpr const indirecting_domain<StatusCode> &indirecting_domain<StatusCode>::get() { return _indirecting_domain<StatusCode>; }
+  template <class StatusCode, class Allocator> constexpr shared_indirecting_domain<StatusCode, Allocator> _shared_indirecting_domain{};
+  template <class StatusCode, class Allocator> inline constexpr const shared_indirecting_domain<StatusCode, Allocator> &shared_indirecting_domain<StatusCode, Allocator>::get() { return _shared_indirecting_domain<StatusCode, Allocator>; }
 #endif
+
+  /* Registers an indirecting domain during static initialisation, once for each instantiation
+  which is named by a function making codes of it. Making a code thus never tests a guard.
+  */
+  template <class Domain> struct indirecting_domain_registration
+  {
+    static const bool registered;
+  };
+  inline bool register_indirecting_domain(const indirecting_domain_base &domain) noexcept
+  {
+    const bool indexed = domain_registry_insert<indirecting_domain_base>(domain);
+    return register_domain(domain) && indexed;
+  }
+  template <class Domain> const bool indirecting_domain_registration<Domain>::registered = register_indirecting_domain(Domain::get());
 }  // namespace detail
 
+/*! Make an erased status code which indirects to a status code dynamically allocated
+using `alloc`, which is rebound as necessary. A copy of the allocator is kept alongside
+the status code, and is used to allocate copies made by erased copy, and to deallocate.
+The domain id of the result depends on `traits::status_code_ptr_allocator_tag<Alloc>`, but
+`get_if()` and `get_id()` find the indirected status code whichever allocator was used.
+Note that this function can throw whatever the allocator throws.
+*/
+template <class T, class Alloc, typename std::enable_if<is_status_code<T>::value && !std::is_pointer<Alloc>::value, bool>::type = true>  //
+inline status_code<erased<typename std::add_pointer<typename std::decay<T>::type>::type>> make_status_code_ptr(T &&v, const Alloc &alloc)
+{
+  using status_code_type = typename std::decay<T>::type;
+  using domain_type = detail::indirecting_domain<status_code_type, typename std::allocator_traits<Alloc>::template rebind_alloc<status_code_type>>;
+  // Instantiates the registration of this domain, without any cost here
+  (void) detail::indirecting_domain_registration<domain_type>::registered;
+  SYSTEM_ERROR2_USDT_PROBE(indirect, v.empty() ? 0 : v.domain().id(), v.empty() ? 0 : detail::diagnostic_value(v.value()));
+  return status_code<domain_type>(in_place, domain_type::_make_payload(alloc, static_cast<T &&>(v)));
+}
+
 /*! Make an erased status code which indirects to a dynamically allocated status code.
 This is useful for shoehorning a rich status code with large value type into a small
 erased status code like `system_code`, with which the status code generated by this
-function is compatible. Note that this function can throw due to `bad_alloc`.
+function is compatible. Allocation is performed by `status_code_ptr_allocator`, which
+caches blocks per thread and has an emergency reserve for when the free store is exhausted.
+Note that this function can throw due to `bad_alloc`.
 */
 template <class T, typename std::enable_if<is_status_code<T>::value, bool>::type = true>  //
 inline status_code<erased<typename std::add_pointer<typename std::decay<T>::type>::type>> make_status_code_ptr(T &&v)
+{
+  return make_status_code_ptr(static_cast<T &&>(v), status_code_ptr_allocator<typename std::decay<T>::type>());
+}
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+/*! \overload Make an erased status code which indirects to a status code allocated from
+the memory resource `mr`, which must outlive the status code and all its copies.
+*/
+template <class T, typename std::enable_if<is_status_code<T>::value, bool>::type = true>  //
+inline status_code<erased<typename std::add_pointer<typename std::decay<T>::type>::type>> make_status_code_ptr(T &&v, std::pmr::memory_resource *mr)
+{
+  return make_status_code_ptr(static_cast<T &&>(v), std::pmr::polymorphic_allocator<typename std::decay<T>::type>(mr));
+}
+#endif
+#endif
+
+/*! Make an erased status code which indirects to a status code dynamically allocated
+using `alloc`, like `make_status_code_ptr()`, except that erased copies (e.g. `clone()`)
+share the same allocation by incrementing an intrusive atomic reference count, and
+the last copy to be destroyed releases it. As all copies refer to the same status code,
+anything modified through `get_if()` is visible through every copy.
+Note that this function can throw whatever the allocator throws.
+*/
+template <class T, class Alloc, typename std::enable_if<is_status_code<T>::value && !std::is_pointer<Alloc>::value, bool>::type = true>  //
+inline status_code<erased<typename std::add_pointer<typename std::decay<T>::type>::type>> make_shared_status_code_ptr(T &&v, const Alloc &alloc)
 {
   using status_code_type = typename std::decay<T>::type;
-  return status_code<detail::indirecting_domain<status_code_type>>(in_place, new status_code_type(static_cast<T &&>(v)));
+  using domain_type = detail::shared_indirecting_domain<status_code_type, typename std::allocator_traits<Alloc>::template rebind_alloc<status_code_type>>;
+  // Instantiates the registration of this domain, without any cost here
+  (void) detail::indirecting_domain_registration<domain_type>::registered;
+  SYSTEM_ERROR2_USDT_PROBE(indirect, v.empty() ? 0 : v.domain().id(), v.empty() ? 0 : detail::diagnostic_value(v.value()));
+  return status_code<domain_type>(in_place, domain_type::_make_payload(alloc, static_cast<T &&>(v)));
+}
+
+//! \overload Allocates using `status_code_ptr_allocator`
+template <class T, typename std::enable_if<is_status_code<T>::value, bool>::type = true>  //
+inline status_code<erased<typename std::add_pointer<typename std::decay<T>::type>::type>> make_shared_status_code_ptr(T &&v)
+{
+  return make_shared_status_code_ptr(static_cast<T &&>(v), status_code_ptr_allocator<typename std::decay<T>::type>());
+}
+
+/*! Make an erased status code of type `status_code<erased<ErasedType>>` from the status
+code `v`. If the value type of `v` is move bitcopying and would fit into the erased storage
+(i.e. `detail::type_erasure_is_safe<ErasedType, value_type>`), `v` is erased in place
+without allocation. Otherwise `v` is indirected to the heap via `make_status_code_ptr()`.
+The choice is made at compile time, so generic code never pays for an allocation which
+the size of the value type does not require.
+*/
+template <class ErasedType = intptr_t, class T,
+          typename std::enable_if<is_status_code<T>::value && !detail::is_erased_status_code<typename std::decay<T>::type>::value                      //
+                                  && detail::type_erasure_is_safe<ErasedType, typename std::decay<T>::type::value_type>::value,  // fits inline
+                                  bool>::type = true>
+inline status_code<erased<ErasedType>> make_status_code_erased(T &&v) noexcept(std::is_nothrow_constructible<typename std::decay<T>::type, T>::value)
+{
+  return status_code<erased<ErasedType>>(typename std::decay<T>::type(static_cast<T &&>(v)));
+}
+//! \overload Indirects to the heap because the value type cannot be erased in place
+template <class ErasedType = intptr_t, class T,
+          typename std::enable_if<is_status_code<T>::value && !detail::is_erased_status_code<typename std::decay<T>::type>::value                       //
+                                  && !detail::type_erasure_is_safe<ErasedType, typename std::decay<T>::type::value_type>::value,  // does not fit inline
+                                  bool>::type = true>
+inline status_code<erased<ErasedType>> make_status_code_erased(T &&v)
+{
+  static_assert(detail::type_erasure_is_safe<ErasedType, typename std::add_pointer<typename std::decay<T>::type>::type>::value, "ErasedType cannot hold a pointer to the indirected status code");
+  return make_status_code_ptr(static_cast<T &&>(v));
 }
 
 /*! If a status code refers to a `status_code_ptr` which indirects to a status
@@ -134,7 +809,7 @@ code of type `StatusCode`, return a pointer to that `StatusCode`. Otherwise retu
 */
 template <class StatusCode, class U, typename std::enable_if<is_status_code<StatusCode>::value, bool>::type = true> inline StatusCode *get_if(status_code<erased<U>> *v) noexcept
 {
-  if((0xc44f7bdeb2cc50e9 ^ typename StatusCode::domain_type().id()) != v->domain().id())
+  if(!detail::indirecting_domain_ids::indirects_to(v->domain(), typename StatusCode::domain_type().id()))
   {
     return nullptr;
   }
@@ -148,7 +823,7 @@ template <class StatusCode, class U, typename std::enable_if<is_status_code<Stat
 //! \overload Const overload
 template <class StatusCode, class U, typename std::enable_if<is_status_code<StatusCode>::value, bool>::type = true> inline const StatusCode *get_if(const status_code<erased<U>> *v) noexcept
 {
-  if((0xc44f7bdeb2cc50e9 ^ typename StatusCode::domain_type().id()) != v->domain().id())
+  if(!detail::indirecting_domain_ids::indirects_to(v->domain(), typename StatusCode::domain_type().id()))
   {
     return nullptr;
   }
@@ -161,11 +836,13 @@ template <class StatusCode, class U, typename std::enable_if<is_status_code<Stat
 }
 
 /*! If a status code refers to a `status_code_ptr`, return the id of the erased
-status code's domain. Otherwise return a meaningless number.
+status code's domain, whichever allocator and ownership it was made with. Otherwise
+return a meaningless number.
 */
 template <class U> inline typename status_code_domain::unique_id_type get_id(const status_code<erased<U>> &v) noexcept
 {
-  return 0xc44f7bdeb2cc50e9 ^ v.domain().id();
+  const detail::indirecting_domain_base *d = detail::indirecting_domain_base::find(v.domain().id());
+  return (d != nullptr) ? d->indirected_id() : (detail::indirecting_domain_ids::base ^ v.domain().id());
 }
 
 SYSTEM_ERROR2_NAMESPACE_END
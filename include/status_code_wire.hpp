@@ -0,0 +1,296 @@
+/* Compact binary wire format for status codes
+(C) 2026 agent <agent@local> (3 commits)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+#ifndef SYSTEM_ERROR2_STATUS_CODE_WIRE_HPP
+#define SYSTEM_ERROR2_STATUS_CODE_WIRE_HPP
+
+#include "provenance.hpp"
+
+#include <cstdint>
+
+SYSTEM_ERROR2_NAMESPACE_BEGIN
+
+/*! The maximum number of bytes `encode_status_code()` writes.
+
+A frame is a tag byte followed by a payload:
+
+- `0`: an empty code, with no payload.
+- `1`: a `generic_code`, followed by its portable errc number as an unsigned LEB128 varint.
+- `2`: a `posix_code`, followed by the portable errc number of its errno as an unsigned LEB128 varint.
+- `3`: a code of any other domain, or one of the above without a portable number, followed by the
+eight byte little endian unique id of its domain, then its value as a zigzag encoded LEB128 varint.
+*/
+constexpr size_t status_code_wire_max_size = 1 + 8 + 10;
+
+namespace detail
+{
+  // The canonical portable numbering of errc on the wire is one plus the index into this table. It
+  // must never be reordered, and new entries must be appended.
+  inline const errc *portable_errc_table(size_t &count) noexcept
+  {
+    static constexpr errc table[] = {
+    errc::address_family_not_supported, errc::address_in_use, errc::address_not_available, errc::already_connected, errc::argument_list_too_long, errc::argument_out_of_domain, errc::bad_address, errc::bad_file_descriptor, errc::bad_message, errc::broken_pipe,  //
+    errc::connection_aborted, errc::connection_already_in_progress, errc::connection_refused, errc::connection_reset, errc::cross_device_link, errc::destination_address_required, errc::device_or_resource_busy, errc::directory_not_empty, errc::executable_format_error,
+    errc::file_exists, errc::file_too_large, errc::filename_too_long, errc::function_not_supported, errc::host_unreachable, errc::identifier_removed, errc::illegal_byte_sequence, errc::inappropriate_io_control_operation, errc::interrupted, errc::invalid_argument,
+    errc::invalid_seek, errc::io_error, errc::is_a_directory, errc::message_size, errc::network_down, errc::network_reset, errc::network_unreachable, errc::no_buffer_space, errc::no_child_process, errc::no_link, errc::no_lock_available, errc::no_message,
+    errc::no_protocol_option, errc::no_space_on_device, errc::no_stream_resources, errc::no_such_device_or_address, errc::no_such_device, errc::no_such_file_or_directory, errc::no_such_process, errc::not_a_directory, errc::not_a_socket, errc::not_a_stream,
+    errc::not_connected, errc::not_enough_memory, errc::not_supported, errc::operation_canceled, errc::operation_in_progress, errc::operation_not_permitted, errc::operation_not_supported, errc::operation_would_block, errc::owner_dead, errc::permission_denied,
+    errc::protocol_error, errc::protocol_not_supported, errc::read_only_file_system, errc::resource_deadlock_would_occur, errc::resource_unavailable_try_again, errc::result_out_of_range, errc::state_not_recoverable, errc::stream_timeout, errc::text_file_busy,
+    errc::timed_out, errc::too_many_files_open_in_system, errc::too_many_files_open, errc::too_many_links, errc::too_many_symbolic_link_levels, errc::value_too_large, errc::wrong_protocol_type};
+    count = sizeof(table) / sizeof(table[0]);
+    return table;
+  }
+  // The reverse of the table, indexed by host errc value
+  struct portable_errc_map
+  {
+    unsigned char numbers[256]{};
+    portable_errc_map() noexcept
+    {
+      size_t count;
+      const errc *table = portable_errc_table(count);
+      // Where errc values alias on this host, the first in the table is sent
+      for(size_t n = count; n > 0; n--)
+      {
+        const auto v = static_cast<unsigned>(table[n - 1]);
+        if(v < 256)
+        {
+          numbers[v] = static_cast<unsigned char>(n);
+        }
+      }
+    }
+  };
+}  // namespace detail
+
+//! Returns the canonical portable number of `c`, which is zero for success, or -1 if `c` has none.
+inline int to_portable_errc(errc c) noexcept
+{
+  static const detail::portable_errc_map map;
+  const auto v = static_cast<unsigned>(c);
+  if(c == errc::success)
+  {
+    return 0;
+  }
+  return (v < 256 && map.numbers[v] != 0) ? map.numbers[v] : -1;
+}
+//! Returns the host `errc` with canonical portable number `n`, or `errc::unknown` if there is none.
+inline errc from_portable_errc(unsigned n) noexcept
+{
+  size_t count;
+  const errc *table = detail::portable_errc_table(count);
+  if(n == 0)
+  {
+    return errc::success;
+  }
+  return (n <= count) ? table[n - 1] : errc::unknown;
+}
+
+namespace detail
+{
+  struct wire_codec
+  {
+    static unsigned char *put_varint(unsigned char *p, unsigned long long v) noexcept
+    {
+      while(v >= 0x80)
+      {
+        *p++ = static_cast<unsigned char>(v | 0x80);
+        v >>= 7U;
+      }
+      *p++ = static_cast<unsigned char>(v);
+      return p;
+    }
+    static const unsigned char *get_varint(const unsigned char *p, const unsigned char *e, unsigned long long &v) noexcept
+    {
+      v = 0;
+      for(unsigned shift = 0; p != e && shift < 64; shift += 7)
+      {
+        const unsigned char b = *p++;
+        v |= static_cast<unsigned long long>(b & 0x7f) << shift;
+        if((b & 0x80) == 0)
+        {
+          return p;
+        }
+      }
+      return nullptr;
+    }
+
+    // Writes a frame for a code of `domain`, whose value erases to `value`, into a buffer of at least status_code_wire_max_size bytes
+    static size_t encode(unsigned char *buffer, const status_code_domain *domain, intptr_t value) noexcept
+    {
+      unsigned char *p = buffer;
+      if(domain == nullptr)
+      {
+        *p++ = 0;
+        return 1;
+      }
+      const auto id = domain->id();
+      if(id == generic_code_domain.id() || (id == posix_domain_id() && value == static_cast<int>(value)))
+      {
+        const int portable = to_portable_errc(static_cast<errc>(value));
+        if(portable >= 0)
+        {
+          *p++ = (id == generic_code_domain.id()) ? 1 : 2;
+          return static_cast<size_t>(put_varint(p, static_cast<unsigned>(portable)) - buffer);
+        }
+      }
+      *p++ = 3;
+      for(unsigned n = 0; n < 8; n++)
+      {
+        *p++ = static_cast<unsigned char>(id >> (8 * n));
+      }
+      const auto v = static_cast<long long>(value);
+      return static_cast<size_t>(put_varint(p, (static_cast<unsigned long long>(v) << 1U) ^ static_cast<unsigned long long>(v >> 63)) - buffer);
+    }
+
+    // Destroys whatever out held, which move assignment would not ask its domain to do
+    static void assign(system_code &out, system_code &&v) noexcept
+    {
+      out.~system_code();
+      new(&out) system_code(static_cast<system_code &&>(v));
+    }
+
+    static size_t decode(system_code &out, const unsigned char *buffer, size_t size) noexcept
+    {
+      const unsigned char *p = buffer, *e = buffer + size;
+      if(p == e)
+      {
+        return 0;
+      }
+      const unsigned char tag = *p++;
+      unsigned long long v;
+      switch(tag)
+      {
+      case 0:
+        assign(out, system_code());
+        return 1;
+      case 1:
+      case 2:
+      {
+        if((p = get_varint(p, e, v)) == nullptr || v > 0xffffffff)
+        {
+          return 0;
+        }
+        const errc c = from_portable_errc(static_cast<unsigned>(v));
+        if(c == errc::unknown)
+        {
+          return 0;
+        }
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+        if(tag == 2)
+        {
+          assign(out, system_code(posix_code(static_cast<int>(c))));
+          return static_cast<size_t>(p - buffer);
+        }
+#endif
+        // Without posix_code, a posix_code is received as its generic code
+        assign(out, system_code(generic_code(c)));
+        return static_cast<size_t>(p - buffer);
+      }
+      case 3:
+      {
+        if(e - p < 8)
+        {
+          return 0;
+        }
+        unsigned long long id = 0;
+        for(unsigned n = 0; n < 8; n++)
+        {
+          id |= static_cast<unsigned long long>(*p++) << (8 * n);
+        }
+        if((p = get_varint(p, e, v)) == nullptr)
+        {
+          return 0;
+        }
+        const auto value = static_cast<long long>((v >> 1U) ^ (0 - (v & 1)));
+        // Only domains whose values are integers, else the value would be trusted as a pointer
+        const status_code_domain *domain = find_integral_domain(id);
+        if(domain == nullptr || value != static_cast<intptr_t>(value))
+        {
+          return 0;
+        }
+        assign(out, system_code(domain, static_cast<intptr_t>(value)));
+        return static_cast<size_t>(p - buffer);
+      }
+      default:
+        return 0;
+      }
+    }
+
+    static unsigned long long posix_domain_id() noexcept
+    {
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+      return posix_code_domain.id();
+#else
+      return 0;
+#endif
+    }
+  };
+}  // namespace detail
+
+/*! Writes `code` into `buffer` as a frame of at most `status_code_wire_max_size` bytes, returning the
+number of bytes written, or zero if `size` was too small. Generic and POSIX codes are sent with the
+canonical portable numbering of `errc` returned by `to_portable_errc()`, so are received as the same
+condition on any platform. Codes of other domains are sent as their domain's unique id and their value,
+so are received as such only where that domain is registered. Never allocates.
+
+Codes whose value is not an integer, or an enum, cannot be sent, as their value is only meaningful
+within this process. For erased codes, this cannot be checked: do not send codes made by
+`make_status_code_ptr()`. Codes made by `with_provenance()` are sent as the code they wrap.
+*/
+template <class DomainType> inline size_t encode_status_code(const status_code<DomainType> &code, unsigned char *buffer, size_t size) noexcept
+{
+  using value_type = typename status_code<DomainType>::value_type;
+  static_assert(std::is_integral<value_type>::value || std::is_enum<value_type>::value, "Only status codes with integer or enum values can be sent");
+  static_assert(detail::type_erasure_is_safe<intptr_t, value_type>::value, "Only status codes whose values fit into an intptr_t can be sent");
+  if(code.empty())
+  {
+    return (size > 0) ? detail::wire_codec::encode(buffer, nullptr, 0) : 0;
+  }
+  if(detail::is_erased_status_code<status_code<DomainType>>::value && code.domain() == detail::provenance_domain::get())
+  {
+    return encode_status_code(static_cast<const status_code<detail::provenance_domain> &>(static_cast<const status_code<void> &>(code)).value()->sc, buffer, size);  // NOLINT
+  }
+  if(size >= status_code_wire_max_size)
+  {
+    return detail::wire_codec::encode(buffer, &code.domain(), detail::erasure_cast<intptr_t>(code.value()));
+  }
+  unsigned char temp[status_code_wire_max_size];
+  const size_t written = detail::wire_codec::encode(temp, &code.domain(), detail::erasure_cast<intptr_t>(code.value()));
+  if(written > size)
+  {
+    return 0;
+  }
+  memcpy(buffer, temp, written);
+  return written;
+}
+
+/*! Reads a frame written by `encode_status_code()` from `buffer` into `out`, returning the number of bytes
+read, or zero if the frame is truncated or malformed, or its domain is not registered with `find_domain()`
+as one whose value is an integer or enum. Frames naming any other domain, such as those of `make_status_code_ptr()`
+or `with_provenance()`, whose values are pointers, are malformed. Never allocates.
+*/
+inline size_t decode_status_code(system_code &out, const unsigned char *buffer, size_t size) noexcept { return detail::wire_codec::decode(out, buffer, size); }
+
+SYSTEM_ERROR2_NAMESPACE_END
+
+#endif
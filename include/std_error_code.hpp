@@ -55,7 +55,7 @@ using std_error_code = status_code<_error_code_domain<std::error_code, detail::m
 template <class error_code_type, class make_categories_type> class _error_code_domain : public status_code_domain
 {
   template <class DomainType> friend class status_code;
-  template <class StatusCode> friend class detail::indirecting_domain;
+  template <class StatusCode, class Allocator> friend class detail::indirecting_domain;
   using _base = status_code_domain;
   using _status_code = status_code<_error_code_domain>;
 
@@ -64,13 +64,7 @@ template <class error_code_type, class make_categories_type> class _error_code_d
     try
     {
       std::string msg = c.message();
-      auto *p = static_cast<char *>(malloc(msg.size() + 1));  // NOLINT
-      if(p == nullptr)
-      {
-        return _base::string_ref("failed to allocate message");
-      }
-      memcpy(p, msg.c_str(), msg.size() + 1);
-      return _base::atomic_refcounted_string_ref(p, msg.size());
+      return _base::atomic_refcounted_block_string_ref(msg.c_str(), msg.size());
     }
     catch(...)
     {
@@ -166,6 +160,7 @@ protected:
 };
 //! A constexpr source variable for the `std::error_code` code domain. Returned by `_error_code_domain<error_code_type, detail::make_std_categoriesy>::get()`.
 constexpr _error_code_domain<std::error_code, detail::make_std_categories> std_error_code_domain;
+SYSTEM_ERROR2_REGISTER_DOMAIN(std_error_code_domain);
 template <class error_code_type, class make_categories_type> inline constexpr const _error_code_domain<error_code_type, make_categories_type> &_error_code_domain<error_code_type, make_categories_type>::get()
 {
   return std_error_code_domain;
@@ -57,6 +57,34 @@ static_assert(sizeof(system_code) == 2 * sizeof(void *), "system_code is not exa
 static_assert(traits::is_move_bitcopying<system_code>::value, "system_code is not move bitcopying!");
 #endif
 
+namespace detail
+{
+  //! The erased storage of `system_code_wide`, three pointers of trivially copyable bytes.
+  struct system_code_wide_storage
+  {
+    intptr_t value[3];
+  };
+}  // namespace detail
+
+/*! A wider erased-mutable status code, four pointers in size, which can hold
+in place any status code whose value type is move bitcopying and no larger than
+three pointers. This lets rich status codes with, for example, an errno plus a
+source location, be type erased without `make_status_code_ptr()` and its allocation.
+
+Any `system_code` can be moved into a `system_code_wide`. The reverse needs
+`make_status_code_ptr()`, which can indirect an erased status code.
+
+Note that `system_code_wide` has a non-trivial destructor, so like `system_code`
+the SysV x64 ABI passes and returns it via a pointer to memory, never in registers.
+See doc/system_code_wide.md.
+*/
+using system_code_wide = status_code<erased<detail::system_code_wide_storage>>;
+
+#ifndef NDEBUG
+static_assert(sizeof(system_code_wide) == 4 * sizeof(void *), "system_code_wide is not exactly four pointers in size!");
+static_assert(traits::is_move_bitcopying<system_code_wide>::value, "system_code_wide is not move bitcopying!");
+#endif
+
 SYSTEM_ERROR2_NAMESPACE_END
 
 #endif
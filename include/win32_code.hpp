@@ -68,7 +68,7 @@ using win32_error = status_error<_win32_code_domain>;
 class _win32_code_domain : public status_code_domain
 {
   template <class DomainType> friend class status_code;
-  template <class StatusCode> friend class detail::indirecting_domain;
+  template <class StatusCode, class Allocator> friend class detail::indirecting_domain;
   friend class _com_code_domain;
   using _base = status_code_domain;
   static int _win32_code_to_errno(win32::DWORD c)
@@ -139,13 +139,15 @@ public:
 
   //! Constexpr singleton getter. Returns the constexpr win32_code_domain variable.
   static inline constexpr const _win32_code_domain &get();
+  //! True if a code of this domain with value `v` is a failure, without need of a virtual function call.
+  static constexpr bool _failure_of(const value_type &v) noexcept { return v != 0; }
 
   virtual string_ref name() const noexcept override { return string_ref("win32 domain"); }  // NOLINT
 protected:
   virtual bool _do_failure(const status_code<void> &code) const noexcept override  // NOLINT
   {
     assert(code.domain() == *this);
-    return static_cast<const win32_code &>(code).value() != 0;  // NOLINT
+    return _failure_of(static_cast<const win32_code &>(code).value());  // NOLINT
   }
   virtual bool _do_equivalent(const status_code<void> &code1, const status_code<void> &code2) const noexcept override  // NOLINT
   {
@@ -189,6 +191,7 @@ protected:
 };
 //! (Windows only) A constexpr source variable for the win32 code domain, which is that of `GetLastError()` (Windows). Returned by `_win32_code_domain::get()`.
 constexpr _win32_code_domain win32_code_domain;
+SYSTEM_ERROR2_REGISTER_DOMAIN(win32_code_domain);
 inline constexpr const _win32_code_domain &_win32_code_domain::get()
 {
   return win32_code_domain;
@@ -0,0 +1,1282 @@
+/* Proposed SG14 status_code benchmarking
+(C) 2026 agent <agent@local> (20 commits)
+File Created: Oct 2026
+
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License in the accompanying file
+Licence.txt or at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+
+Distributed under the Boost Software License, Version 1.0.
+(See accompanying file Licence.txt or copy at
+http://www.boost.org/LICENSE_1_0.txt)
+*/
+
+/* Measures ns/op for the hot operations of status code, and for the nearest
+equivalent operation on `std::error_code`. Results are written to stdout as
+JSON so they can be diffed between builds to catch regressions:
+
+  bench-status-code [--min-time-ms=N] [--filter=substring]
+
+Each result has a `group` naming the operation being measured, and a
+`subject` naming what it was measured on. Where a `std::error_code` result
+exists in the same group, `vs_std_error_code` gives the ratio of the two.
+*/
+
+#ifndef _WIN32
+#include "cached_message_domain.hpp"
+#include "format_support.hpp"
+#include "getaddrinfo_code.hpp"
+#endif
+
+#include "portable_code.hpp"
+#include "provenance.hpp"
+#include "result.hpp"
+#include "status_code_counters.hpp"
+#include "status_code_flat_map.hpp"
+#include "status_code_ptr.hpp"
+#include "status_code_wire.hpp"
+#include "std_error_code.hpp"
+#include "system_error2.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace bench
+{
+  // Prevent the compiler from eliding computation of, or assuming anything about, v
+  template <class T> inline void do_not_optimize(const T &v)
+  {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&v) : "memory");
+#else
+    static volatile const void *sink;
+    sink = &v;
+    _ReadWriteBarrier();
+#endif
+  }
+
+  struct result
+  {
+    std::string group, subject;
+    double ns_per_op;
+    unsigned long long iterations;
+    unsigned threads;
+    double bytes_per_op{0};
+  };
+
+  struct options
+  {
+    unsigned min_time_ms{50};
+    const char *filter{nullptr};
+  };
+
+  inline options &opts()
+  {
+    static options v;
+    return v;
+  }
+  inline std::vector<result> &results()
+  {
+    static std::vector<result> v;
+    return v;
+  }
+
+  inline bool selected(const char *group, const char *subject)
+  {
+    if(opts().filter == nullptr)
+    {
+      return true;
+    }
+    return strstr(group, opts().filter) != nullptr || strstr(subject, opts().filter) != nullptr;
+  }
+
+  using clock = std::chrono::steady_clock;
+
+  /* Runs `f(iterations)` with doubling iteration counts until it takes at least
+  the minimum time, then records the ns/op of the final run. If each op processes
+  `bytes_per_op` bytes, the throughput is recorded too.
+  */
+  template <class F> inline void run(const char *group, const char *subject, F &&f, double bytes_per_op = 0)
+  {
+    if(!selected(group, subject))
+    {
+      return;
+    }
+    const auto min_time = std::chrono::milliseconds(opts().min_time_ms);
+    unsigned long long iterations = 16;
+    f(iterations);  // warm up
+    for(;;)
+    {
+      auto begin = clock::now();
+      f(iterations);
+      auto elapsed = clock::now() - begin;
+      if(elapsed >= min_time || iterations >= (1ULL << 40))
+      {
+        double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        results().push_back({group, subject, ns / static_cast<double>(iterations), iterations, 1, bytes_per_op});
+        if(bytes_per_op > 0)
+        {
+          fprintf(stderr, "%-40s %-36s %10.2f ns/op %8.3f GB/s\n", group, subject, results().back().ns_per_op, bytes_per_op / results().back().ns_per_op);
+        }
+        else
+        {
+          fprintf(stderr, "%-40s %-36s %10.2f ns/op\n", group, subject, results().back().ns_per_op);
+        }
+        return;
+      }
+      iterations *= 2;
+    }
+  }
+
+  /* Runs `f(iterations)` concurrently on `threads` threads with doubling iteration
+  counts until the slowest takes at least the minimum time, then records the ns/op
+  as seen by each thread.
+  */
+  template <class F> inline void run_threaded(const char *group, const char *subject, unsigned threads, F &&f)
+  {
+    if(!selected(group, subject))
+    {
+      return;
+    }
+    const auto min_time = std::chrono::milliseconds(opts().min_time_ms);
+    unsigned long long iterations = 16;
+    for(;;)
+    {
+      std::vector<std::thread> workers;
+      workers.reserve(threads);
+      auto begin = clock::now();
+      for(unsigned n = 0; n < threads; n++)
+      {
+        workers.emplace_back([&f, iterations, n] { f(iterations, n); });
+      }
+      for(auto &t : workers)
+      {
+        t.join();
+      }
+      auto elapsed = clock::now() - begin;
+      if(elapsed >= min_time || iterations >= (1ULL << 40))
+      {
+        double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        results().push_back({group, subject, ns / static_cast<double>(iterations), iterations, threads});
+        fprintf(stderr, "%-40s %-30s x%-4u %10.2f ns/op\n", group, subject, threads, results().back().ns_per_op);
+        return;
+      }
+      iterations *= 2;
+    }
+  }
+
+  inline void print_json_string(FILE *out, const std::string &s)
+  {
+    fputc('"', out);
+    for(char c : s)
+    {
+      if(c == '"' || c == '\\')
+      {
+        fputc('\\', out);
+      }
+      fputc(c, out);
+    }
+    fputc('"', out);
+  }
+
+  inline void print_json(FILE *out)
+  {
+    fprintf(out, "{\n  \"benchmark\": \"bench-status-code\",\n  \"config\": {\n");
+#if defined(__clang__)
+    fprintf(out, "    \"compiler\": \"clang %d.%d.%d\",\n", __clang_major__, __clang_minor__, __clang_patchlevel__);
+#elif defined(__GNUC__)
+    fprintf(out, "    \"compiler\": \"gcc %d.%d.%d\",\n", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__);
+#elif defined(_MSC_VER)
+    fprintf(out, "    \"compiler\": \"msvc %d\",\n", _MSC_VER);
+#else
+    fprintf(out, "    \"compiler\": \"unknown\",\n");
+#endif
+#ifdef NDEBUG
+    fprintf(out, "    \"ndebug\": true,\n");
+#else
+    fprintf(out, "    \"ndebug\": false,\n");
+#endif
+#if defined(__OPTIMIZE__) || (defined(_MSC_VER) && !defined(_DEBUG))
+    fprintf(out, "    \"optimized\": true,\n");
+#else
+    fprintf(out, "    \"optimized\": false,\n");
+#endif
+#ifdef SYSTEM_ERROR2_POSIX_MESSAGE_TABLE
+    fprintf(out, "    \"posix_message_table\": true,\n");
+#else
+    fprintf(out, "    \"posix_message_table\": false,\n");
+#endif
+    fprintf(out, "    \"hardware_concurrency\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(out, "    \"sizeof_result_int\": %u,\n", static_cast<unsigned>(sizeof(SYSTEM_ERROR2_NAMESPACE::result<int>)));
+    fprintf(out, "    \"sizeof_variant_error_int\": %u,\n", static_cast<unsigned>(sizeof(std::variant<SYSTEM_ERROR2_NAMESPACE::error, int>)));
+    fprintf(out, "    \"min_time_ms\": %u\n  },\n  \"results\": [\n", opts().min_time_ms);
+    const auto &rs = results();
+    for(size_t n = 0; n < rs.size(); n++)
+    {
+      const auto &r = rs[n];
+      fprintf(out, "    {\"group\": ");
+      print_json_string(out, r.group);
+      fprintf(out, ", \"subject\": ");
+      print_json_string(out, r.subject);
+      fprintf(out, ", \"threads\": %u, \"iterations\": %llu, \"ns_per_op\": %.3f", r.threads, r.iterations, r.ns_per_op);
+      if(r.bytes_per_op > 0)
+      {
+        // Bytes per nanosecond is GB/s
+        fprintf(out, ", \"gb_per_s\": %.3f", r.bytes_per_op / r.ns_per_op);
+      }
+      for(const auto &b : rs)
+      {
+        if(&b != &r && b.group == r.group && b.threads == r.threads && b.subject == "std::error_code" && b.ns_per_op > 0)
+        {
+          fprintf(out, ", \"vs_std_error_code\": %.3f", r.ns_per_op / b.ns_per_op);
+          break;
+        }
+      }
+      fprintf(out, "}%s\n", (n + 1 < rs.size()) ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+  }
+}  // namespace bench
+
+using namespace SYSTEM_ERROR2_NAMESPACE;
+
+// Inputs are read through volatiles so the compiler cannot constant fold them
+static volatile int input_errno = EACCES;
+static volatile int input_errno2 = ENOENT;
+static int errno1() { return input_errno; }
+static int errno2() { return input_errno2; }
+
+static void bench_construct()
+{
+  bench::run("construct/errc", "generic_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      generic_code c(static_cast<errc>(errno1()));
+      bench::do_not_optimize(c);
+    }
+  });
+  bench::run("construct/errc", "std::error_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      std::error_code c(make_error_code(static_cast<std::errc>(errno1())));
+      bench::do_not_optimize(c);
+    }
+  });
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  bench::run("construct/errno", "posix_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      posix_code c(errno1());
+      bench::do_not_optimize(c);
+    }
+  });
+  bench::run("construct/errno", "std::error_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      std::error_code c(errno1(), std::system_category());
+      bench::do_not_optimize(c);
+    }
+  });
+#endif
+}
+
+static void bench_erase()
+{
+  bench::run("erase/to_system_code", "generic_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      system_code c{generic_code(static_cast<errc>(errno1()))};
+      bench::do_not_optimize(c);
+    }
+  });
+  bench::run("erase/to_error", "generic_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      error c{generic_code(static_cast<errc>(errno1()))};
+      bench::do_not_optimize(c);
+    }
+  });
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  bench::run("erase/to_system_code", "posix_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      system_code c{posix_code(errno1())};
+      bench::do_not_optimize(c);
+    }
+  });
+  bench::run("erase/to_error", "posix_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      error c{posix_code(errno1())};
+      bench::do_not_optimize(c);
+    }
+  });
+  // A domain which cannot say whether a code is a failure without a virtual function call, so is not asked
+  bench::run("erase/to_system_code", "cached_message_domain<posix>", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      system_code c{status_code<cached_message_domain<_posix_code_domain>>(errno1())};
+      bench::do_not_optimize(c);
+    }
+  });
+#endif
+  bench::run("erase/to_system_code", "std::error_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      std::error_code c(errno1(), std::system_category());
+      bench::do_not_optimize(c);
+    }
+  });
+  bench::run("erase/to_error", "std::error_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      std::error_code c(errno1(), std::system_category());
+      bench::do_not_optimize(c);
+    }
+  });
+}
+
+static void bench_failure()
+{
+  bench::run("failure", "system_code", [](unsigned long long iterations) {
+    system_code c{generic_code(static_cast<errc>(errno1()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(c);
+      bool f = c.failure();
+      bench::do_not_optimize(f);
+    }
+  });
+  bench::run("failure", "error", [](unsigned long long iterations) {
+    error c{generic_code(static_cast<errc>(errno1()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(c);
+      bool f = c.failure();
+      bench::do_not_optimize(f);
+    }
+  });
+  bench::run("failure", "system_code from error", [](unsigned long long iterations) {
+    system_code c{error{generic_code(static_cast<errc>(errno1()))}};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(c);
+      bool f = c.failure();
+      bench::do_not_optimize(f);
+    }
+  });
+  bench::run("failure", "std::error_code", [](unsigned long long iterations) {
+    std::error_code c(errno1(), std::generic_category());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(c);
+      bool f = !!c;
+      bench::do_not_optimize(f);
+    }
+  });
+}
+
+static void bench_equivalent()
+{
+  // Same domain
+  bench::run("equivalent/same_domain", "generic_code", [](unsigned long long iterations) {
+    generic_code a(static_cast<errc>(errno1())), b(static_cast<errc>(errno2()));
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(b);
+      bool r = (a == b);
+      bench::do_not_optimize(r);
+    }
+  });
+  bench::run("equivalent/same_domain", "system_code", [](unsigned long long iterations) {
+    system_code a{generic_code(static_cast<errc>(errno1()))}, b{generic_code(static_cast<errc>(errno2()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(b);
+      bool r = (a == b);
+      bench::do_not_optimize(r);
+    }
+  });
+  bench::run("equivalent/same_domain", "error", [](unsigned long long iterations) {
+    error a{generic_code(static_cast<errc>(errno1()))}, b{generic_code(static_cast<errc>(errno2()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(b);
+      bool r = (a == b);
+      bench::do_not_optimize(r);
+    }
+  });
+  bench::run("equivalent/same_domain", "std::error_code", [](unsigned long long iterations) {
+    std::error_code a(errno1(), std::generic_category()), b(errno2(), std::generic_category());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(b);
+      bool r = (a == b);
+      bench::do_not_optimize(r);
+    }
+  });
+  // Against an enum literal
+  bench::run("equivalent/enum_literal", "error", [](unsigned long long iterations) {
+    error a{generic_code(static_cast<errc>(errno1()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bool r = (a == errc::no_such_file_or_directory);
+      bench::do_not_optimize(r);
+    }
+  });
+  bench::run("equivalent/enum_literal", "std::error_code", [](unsigned long long iterations) {
+    std::error_code a(errno1(), std::generic_category());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bool r = (a == std::errc::no_such_file_or_directory);
+      bench::do_not_optimize(r);
+    }
+  });
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  bench::run("equivalent/enum_literal", "posix_code", [](unsigned long long iterations) {
+    posix_code a(errno1());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bool r = (a == errc::no_such_file_or_directory);
+      bench::do_not_optimize(r);
+    }
+  });
+  // Across domains
+  bench::run("equivalent/cross_domain", "system_code", [](unsigned long long iterations) {
+    system_code a{posix_code(errno1())}, b{generic_code(static_cast<errc>(errno2()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(b);
+      bool r = (a == b);
+      bench::do_not_optimize(r);
+    }
+  });
+  // The same, with the comparison decided by a registered function
+  register_equivalence(posix_code_domain, generic_code_domain, [](const status_code<void> &code1, const status_code<void> &code2) {
+    return static_cast<const posix_code &>(code1).value() == static_cast<int>(static_cast<const generic_code &>(code2).value());  // NOLINT
+  });
+  bench::run("equivalent/cross_domain", "system_code (registered)", [](unsigned long long iterations) {
+    system_code a{posix_code(errno1())}, b{generic_code(static_cast<errc>(errno2()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(b);
+      bool r = (a == b);
+      bench::do_not_optimize(r);
+    }
+  });
+  register_equivalence(posix_code_domain, generic_code_domain, nullptr);
+  bench::run("equivalent/cross_domain", "std_error_code", [](unsigned long long iterations) {
+    std_error_code a{std::error_code(errno1(), std::system_category())};
+    posix_code b(errno2());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(b);
+      bool r = (a == b);
+      bench::do_not_optimize(r);
+    }
+  });
+#endif
+  bench::run("equivalent/cross_domain", "std::error_code", [](unsigned long long iterations) {
+    std::error_code a(errno1(), std::system_category());
+    std::error_condition b(errno2(), std::generic_category());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(b);
+      bool r = (a == b);
+      bench::do_not_optimize(r);
+    }
+  });
+}
+
+// Retry logic testing whether a failure is any of a set of conditions
+static void bench_errc_set()
+{
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  static const errc members[16] = {errc::timed_out, errc::resource_unavailable_try_again, errc::interrupted, errc::connection_reset, errc::connection_aborted, errc::connection_refused, errc::network_down, errc::network_unreachable, errc::network_reset, errc::host_unreachable, errc::broken_pipe, errc::device_or_resource_busy, errc::not_connected, errc::operation_in_progress, errc::no_buffer_space, errc::text_file_busy};
+  static const errc_set sets[3] = {errc_set(members[0]),  //
+                                   errc_set(members[0], members[1], members[2], members[3]),
+                                   errc_set(members[0], members[1], members[2], members[3], members[4], members[5], members[6], members[7], members[8], members[9], members[10], members[11], members[12], members[13], members[14], members[15])};
+  static const char *const groups[3] = {"is_any_of/1", "is_any_of/4", "is_any_of/16"};
+  static const size_t sizes[3] = {1, 4, 16};
+  for(size_t i = 0; i < 3; i++)
+  {
+    // The code is a member of none of the sets, so every comparison is made
+    bench::run(groups[i], "system_code == each", [i](unsigned long long iterations) {
+      system_code a{posix_code(errno1())};
+      for(unsigned long long n = 0; n < iterations; n++)
+      {
+        bench::do_not_optimize(a);
+        bool r = false;
+        for(size_t m = 0; m < sizes[i] && !r; m++)
+        {
+          r = (a == members[m]);
+        }
+        bench::do_not_optimize(r);
+      }
+    });
+    bench::run(groups[i], "system_code.in(errc_set)", [i](unsigned long long iterations) {
+      system_code a{posix_code(errno1())};
+      for(unsigned long long n = 0; n < iterations; n++)
+      {
+        bench::do_not_optimize(a);
+        bool r = a.in(sets[i]);
+        bench::do_not_optimize(r);
+      }
+    });
+  }
+#endif
+}
+
+static void bench_message()
+{
+  bench::run("message/generic", "generic_code", [](unsigned long long iterations) {
+    generic_code a(static_cast<errc>(errno1()));
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+  bench::run("message/generic", "std::error_code", [](unsigned long long iterations) {
+    std::error_code a(errno1(), std::generic_category());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+  bench::run("message/generic", "generic_code::message_view()", [](unsigned long long iterations) {
+    generic_code a(static_cast<errc>(errno1()));
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message_view();
+      bench::do_not_optimize(msg);
+    }
+  });
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  bench::run("message/system", "posix_code", [](unsigned long long iterations) {
+    posix_code a(errno1());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+  bench::run("message/system", "cached_message_domain<posix>", [](unsigned long long iterations) {
+    status_code<cached_message_domain<_posix_code_domain>> a(errno1());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+  bench::run("message/system", "system_code", [](unsigned long long iterations) {
+    system_code a{posix_code(errno1())};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+  bench::run("message/system", "status_code_ptr", [](unsigned long long iterations) {
+    system_code a{make_status_code_ptr(posix_code(errno1()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+#endif
+  bench::run("message/system", "std_error_code", [](unsigned long long iterations) {
+    std_error_code a{std::error_code(errno1(), std::system_category())};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+  bench::run("message/system", "std::error_code", [](unsigned long long iterations) {
+    std::error_code a(errno1(), std::system_category());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+#ifndef _WIN32
+  bench::run("message/getaddrinfo", "getaddrinfo_code", [](unsigned long long iterations) {
+    getaddrinfo_code a(EAI_NONAME);
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+  bench::run("message/getaddrinfo", "getaddrinfo_code::message_view()", [](unsigned long long iterations) {
+    getaddrinfo_code a(EAI_NONAME);
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message_view();
+      bench::do_not_optimize(msg);
+    }
+  });
+#endif
+}
+
+// Formatting into a caller supplied buffer, as a signal handler or high rate logger would
+static void bench_format_message()
+{
+  bench::run("format_message_to/generic", "generic_code", [](unsigned long long iterations) {
+    generic_code a(static_cast<errc>(errno1()));
+    char buffer[256];
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(a.format_message_to(buffer, sizeof(buffer)));
+    }
+  });
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  bench::run("format_message_to/system", "posix_code", [](unsigned long long iterations) {
+    posix_code a(errno1());
+    char buffer[256];
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(a.format_message_to(buffer, sizeof(buffer)));
+    }
+  });
+  bench::run("format_message_to/system", "system_code", [](unsigned long long iterations) {
+    system_code a{posix_code(errno1())};
+    char buffer[256];
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(a.format_message_to(buffer, sizeof(buffer)));
+    }
+  });
+  bench::run("format_message_to/system", "format_status_code_to", [](unsigned long long iterations) {
+    system_code a{posix_code(errno1())};
+    char buffer[256];
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(format_status_code_to(a, buffer, sizeof(buffer)));
+    }
+  });
+#endif
+#ifndef _WIN32
+  bench::run("format_message_to/getaddrinfo", "getaddrinfo_code", [](unsigned long long iterations) {
+    getaddrinfo_code a(EAI_NONAME);
+    char buffer[256];
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      bench::do_not_optimize(a.format_message_to(buffer, sizeof(buffer)));
+    }
+  });
+#endif
+}
+
+static void bench_message_threaded()
+{
+  // Messages are typically fetched by many threads at once when logging failures
+  const unsigned threads = (std::thread::hardware_concurrency() > 4) ? std::thread::hardware_concurrency() : 4;
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  bench::run_threaded("message/system/threaded", "posix_code", threads, [](unsigned long long iterations, unsigned idx) {
+    posix_code a(errno1() + static_cast<int>(idx % 2));
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+  bench::run_threaded("message/system/threaded", "cached_message_domain<posix>", threads, [](unsigned long long iterations, unsigned idx) {
+    status_code<cached_message_domain<_posix_code_domain>> a(errno1() + static_cast<int>(idx % 2));
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+#endif
+  bench::run_threaded("message/system/threaded", "std::error_code", threads, [](unsigned long long iterations, unsigned idx) {
+    std::error_code a(errno1() + static_cast<int>(idx % 2), std::system_category());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto msg = a.message();
+      bench::do_not_optimize(msg);
+    }
+  });
+}
+
+static void bench_clone()
+{
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  bench::run("clone", "system_code", [](unsigned long long iterations) {
+    system_code a{posix_code(errno1())};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto b = a.clone();
+      bench::do_not_optimize(b);
+    }
+  });
+  bench::run("clone", "status_code_ptr", [](unsigned long long iterations) {
+    system_code a{make_status_code_ptr(posix_code(errno1()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto b = a.clone();
+      bench::do_not_optimize(b);
+    }
+  });
+  bench::run("clone", "shared status_code_ptr", [](unsigned long long iterations) {
+    system_code a{make_shared_status_code_ptr(posix_code(errno1()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto b = a.clone();
+      bench::do_not_optimize(b);
+    }
+  });
+  bench::run("make_status_code_ptr", "posix_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      system_code a{make_status_code_ptr(posix_code(errno1()))};
+      bench::do_not_optimize(a);
+    }
+  });
+  bench::run("make_status_code_ptr", "posix_code std::allocator", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      system_code a{make_status_code_ptr(posix_code(errno1()), std::allocator<posix_code>())};
+      bench::do_not_optimize(a);
+    }
+  });
+#if defined(__cpp_lib_memory_resource)
+  bench::run("make_status_code_ptr", "posix_code pmr::unsynchronized_pool_resource", [](unsigned long long iterations) {
+    std::pmr::unsynchronized_pool_resource mr;
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      system_code a{make_status_code_ptr(posix_code(errno1()), &mr)};
+      bench::do_not_optimize(a);
+    }
+  });
+#endif
+#endif
+  bench::run("erase rich code", "system_code_wide in place", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      system_code_wide a{std_error_code(std::error_code(errno1(), std::generic_category()))};
+      bench::do_not_optimize(a);
+    }
+  });
+  bench::run("erase rich code", "system_code via make_status_code_ptr", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      system_code a{make_status_code_ptr(std_error_code(std::error_code(errno1(), std::generic_category())))};
+      bench::do_not_optimize(a);
+    }
+  });
+  bench::run("erase rich code", "system_code via make_status_code_ptr std::allocator", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      system_code a{make_status_code_ptr(std_error_code(std::error_code(errno1(), std::generic_category())), std::allocator<std_error_code>())};
+      bench::do_not_optimize(a);
+    }
+  });
+  bench::run("clone", "system_code_wide", [](unsigned long long iterations) {
+    system_code_wide a{std_error_code(std::error_code(errno1(), std::generic_category()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto b = a.clone();
+      bench::do_not_optimize(b);
+    }
+  });
+  bench::run("clone", "std::error_code", [](unsigned long long iterations) {
+    std::error_code a(errno1(), std::system_category());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      auto b = a;
+      bench::do_not_optimize(b);
+    }
+  });
+}
+
+/* One thread creates a message string, then it and `threads - 1` other threads concurrently
+copy and release references to it, as when an error is fanned out to worker threads. Records
+the ns/op seen by the creating thread and by the other threads separately.
+*/
+template <class StringRef> static void bench_string_ref_fan_out(const char *subject, unsigned threads)
+{
+  std::string owner_group = "string_ref/fan_out/owner x" + std::to_string(threads);
+  std::string worker_group = "string_ref/fan_out/workers x" + std::to_string(threads);
+  if(!bench::selected(owner_group.c_str(), subject) && !bench::selected(worker_group.c_str(), subject))
+  {
+    return;
+  }
+  const auto min_time = std::chrono::milliseconds(bench::opts().min_time_ms);
+  for(unsigned long long iterations = 16;; iterations *= 2)
+  {
+    std::atomic<const status_code_domain::string_ref *> source{nullptr};
+    std::atomic<unsigned> finished{0};
+    std::vector<std::chrono::nanoseconds> elapsed(threads);
+    std::vector<std::thread> workers;
+    for(unsigned idx = 0; idx < threads; idx++)
+    {
+      workers.emplace_back([&, idx] {
+        const status_code_domain::string_ref *src = nullptr;
+        StringRef *owned = nullptr;
+        if(idx == 0)
+        {
+          owned = new StringRef("Permission denied");
+          src = owned;
+          source.store(src, std::memory_order_release);
+        }
+        else
+        {
+          while((src = source.load(std::memory_order_acquire)) == nullptr)
+          {
+            std::this_thread::yield();
+          }
+        }
+        auto begin = bench::clock::now();
+        for(unsigned long long n = 0; n < iterations; n++)
+        {
+          status_code_domain::string_ref copy(*src);
+          bench::do_not_optimize(copy);
+        }
+        elapsed[idx] = bench::clock::now() - begin;
+        finished.fetch_add(1, std::memory_order_acq_rel);
+        if(idx == 0)
+        {
+          while(finished.load(std::memory_order_acquire) != threads)
+          {
+            std::this_thread::yield();
+          }
+          delete owned;
+        }
+      });
+    }
+    for(auto &t : workers)
+    {
+      t.join();
+    }
+    std::chrono::nanoseconds worker_total{0};
+    for(unsigned idx = 1; idx < threads; idx++)
+    {
+      worker_total += elapsed[idx];
+    }
+    if(elapsed[0] >= min_time || iterations >= (1ULL << 40))
+    {
+      auto record = [&](const std::string &group, std::chrono::nanoseconds ns, unsigned count) {
+        if(count == 0 || !bench::selected(group.c_str(), subject))
+        {
+          return;
+        }
+        bench::results().push_back({group, subject, static_cast<double>(ns.count()) / count / static_cast<double>(iterations), iterations, threads});
+        fprintf(stderr, "%-40s %-36s %10.2f ns/op\n", group.c_str(), subject, bench::results().back().ns_per_op);
+      };
+      record(owner_group, elapsed[0], 1);
+      record(worker_group, worker_total, threads - 1);
+      return;
+    }
+  }
+}
+
+static void bench_string_ref()
+{
+  using block_string_ref = status_code_domain::atomic_refcounted_block_string_ref;
+  using biased_string_ref = status_code_domain::biased_refcounted_string_ref;
+  bench::run("string_ref/copy", "atomic_refcounted_block_string_ref", [](unsigned long long iterations) {
+    block_string_ref src("Permission denied");
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      status_code_domain::string_ref copy(src);
+      bench::do_not_optimize(copy);
+    }
+  });
+  bench::run("string_ref/copy", "biased_refcounted_string_ref", [](unsigned long long iterations) {
+    biased_string_ref src("Permission denied");
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      status_code_domain::string_ref copy(src);
+      bench::do_not_optimize(copy);
+    }
+  });
+  const unsigned hardware = std::thread::hardware_concurrency();
+  for(unsigned threads = 2; threads <= ((hardware > 8) ? hardware : 8); threads *= 2)
+  {
+    bench_string_ref_fan_out<block_string_ref>("atomic_refcounted_block_string_ref", threads);
+    bench_string_ref_fan_out<biased_string_ref>("biased_refcounted_string_ref", threads);
+  }
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+BENCH_NOINLINE static result<int> result_from(int v)
+{
+  if(v < 0)
+  {
+    return generic_code(errc::invalid_argument);
+  }
+  return v;
+}
+BENCH_NOINLINE static std::variant<error, int> variant_from(int v)
+{
+  if(v < 0)
+  {
+    return error(generic_code(errc::invalid_argument));
+  }
+  return v;
+}
+
+/* `std::variant<error, int>` is what `result<int>` used to be implemented with,
+so it serves as the baseline for the niche optimised `result<int>`.
+*/
+static void bench_result()
+{
+  bench::run("result<int> return value", "result<int>", [](unsigned long long iterations) {
+    int acc = 0;
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      auto r = result_from(errno1());
+      acc += r.has_value() ? r.assume_value() : 0;
+    }
+    bench::do_not_optimize(acc);
+  });
+  bench::run("result<int> return value", "std::variant<error, int>", [](unsigned long long iterations) {
+    int acc = 0;
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      auto r = variant_from(errno1());
+      acc += (r.index() == 1) ? *std::get_if<1>(&r) : 0;
+    }
+    bench::do_not_optimize(acc);
+  });
+  bench::run("result<int> return error", "result<int>", [](unsigned long long iterations) {
+    int acc = 0;
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      auto r = result_from(-errno1());
+      acc += r.has_value() ? r.assume_value() : 0;
+    }
+    bench::do_not_optimize(acc);
+  });
+  bench::run("result<int> return error", "std::variant<error, int>", [](unsigned long long iterations) {
+    int acc = 0;
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      auto r = variant_from(-errno1());
+      acc += (r.index() == 1) ? *std::get_if<1>(&r) : 0;
+    }
+    bench::do_not_optimize(acc);
+  });
+}
+
+static void bench_counters()
+{
+  bench::run("status_code_counters::record", "generic_code", [](unsigned long long iterations) {
+    generic_code a(static_cast<errc>(errno1()));
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      status_code_counters::record(a);
+    }
+  });
+  bench::run("status_code_counters::record", "system_code", [](unsigned long long iterations) {
+    system_code a{generic_code(static_cast<errc>(errno1()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      status_code_counters::record(a);
+    }
+  });
+  // Failures are typically recorded by many threads at once, which is what the sharding is for
+  const unsigned threads = (std::thread::hardware_concurrency() > 4) ? std::thread::hardware_concurrency() : 4;
+  bench::run_threaded("status_code_counters::record/threaded", "system_code", threads, [](unsigned long long iterations, unsigned /*unused*/) {
+    system_code a{generic_code(static_cast<errc>(errno1()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(a);
+      status_code_counters::record(a);
+    }
+  });
+  // For comparison, every thread incrementing the same unsharded counter
+  static std::atomic<unsigned long long> shared_count;
+  bench::run_threaded("status_code_counters::record/threaded", "one std::atomic counter", threads, [](unsigned long long iterations, unsigned /*unused*/) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      shared_count.fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  bench::do_not_optimize(shared_count);
+  status_code_counters::reset();
+}
+
+static void bench_provenance()
+{
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  bench::run("with_provenance", "system_code", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      system_code c{posix_code(errno1())};
+      bench::do_not_optimize(c);
+    }
+  });
+  bench::run("with_provenance", "with_provenance(system_code)", [](unsigned long long iterations) {
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      system_code c{with_provenance(posix_code(errno1()))};
+      bench::do_not_optimize(c);
+    }
+  });
+#endif
+}
+
+// Error histograms: counting occurrences of each of a few distinct codes, or of many
+template <class Map> static void bench_histogram(const char *name, const char *variant, int distinct)
+{
+  bench::run(name, variant, [distinct](unsigned long long iterations) {
+    Map map;
+    const int base = errno1();
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      ++map[system_code{posix_code(base + static_cast<int>(n % static_cast<unsigned>(distinct)))}];
+    }
+    bench::do_not_optimize(map);
+  });
+}
+
+static void bench_flat_map()
+{
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  using flat_map = status_code_flat_map<system_code, unsigned long long>;
+  using unordered_map = std::unordered_map<system_code, unsigned long long, exact_hash, exact_equal>;
+  bench_histogram<flat_map>("histogram/32", "status_code_flat_map", 32);
+  bench_histogram<unordered_map>("histogram/32", "std::unordered_map", 32);
+  bench_histogram<flat_map>("histogram/4096", "status_code_flat_map", 4096);
+  bench_histogram<unordered_map>("histogram/4096", "std::unordered_map", 4096);
+#endif
+}
+
+// Sending a mix of generic, POSIX and other codes between processes
+static void bench_wire()
+{
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  static constexpr size_t count = 1024;
+  std::vector<system_code> codes;
+  for(size_t n = 0; n < count; n++)
+  {
+    const int e = errno1() + static_cast<int>(n % 16);
+    switch(n % 3)
+    {
+    case 0:
+      codes.emplace_back(generic_code(static_cast<errc>(e)));
+      break;
+    case 1:
+      codes.emplace_back(posix_code(e));
+      break;
+    default:
+      codes.emplace_back(getaddrinfo_code(-e));
+      break;
+    }
+  }
+  std::vector<unsigned char> stream(count * status_code_wire_max_size);
+  std::vector<size_t> offsets;
+  size_t bytes = 0;
+  for(const auto &c : codes)
+  {
+    offsets.push_back(bytes);
+    bytes += encode_status_code(c, stream.data() + bytes, stream.size() - bytes);
+  }
+  const double bytes_per_op = static_cast<double>(bytes) / count;
+  bench::run(
+  "wire/encode", "encode_status_code", [&](unsigned long long iterations) {
+    unsigned char *p = stream.data();
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      const size_t idx = static_cast<size_t>(n % count);
+      if(idx == 0)
+      {
+        p = stream.data();
+      }
+      p += encode_status_code(codes[idx], p, status_code_wire_max_size);
+    }
+    bench::do_not_optimize(stream);
+  },
+  bytes_per_op);
+  bench::run(
+  "wire/decode", "decode_status_code", [&](unsigned long long iterations) {
+    system_code c;
+    const unsigned char *p = stream.data(), *e = stream.data() + bytes;
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      if(p == e)
+      {
+        p = stream.data();
+      }
+      p += decode_status_code(c, p, static_cast<size_t>(e - p));
+      bench::do_not_optimize(c);
+    }
+  },
+  bytes_per_op);
+#endif
+}
+
+// Passing failures through shared memory, which cannot hold domain pointers
+static void bench_portable()
+{
+#ifndef SYSTEM_ERROR2_NOT_POSIX
+  bench::run("portable/to", "portable_code(system_code)", [](unsigned long long iterations) {
+    const system_code c{posix_code(errno1())};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(c);
+      portable_code p(c);
+      bench::do_not_optimize(p);
+    }
+  });
+  bench::run("portable/from", "portable_code::to_system_code()", [](unsigned long long iterations) {
+    const portable_code p{posix_code(errno1())};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      bench::do_not_optimize(p);
+      system_code c = p.to_system_code();
+      bench::do_not_optimize(c);
+    }
+  });
+#endif
+}
+
+static void bench_throw()
+{
+#if defined(_CPPUNWIND) || defined(__EXCEPTIONS)
+  bench::run("throw_exception", "system_code", [](unsigned long long iterations) {
+    system_code a{generic_code(static_cast<errc>(errno1()))};
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      try
+      {
+        a.throw_exception();
+      }
+      catch(const status_error<void> &e)
+      {
+        bench::do_not_optimize(e);
+      }
+    }
+  });
+  bench::run("throw_exception", "std::error_code", [](unsigned long long iterations) {
+    std::error_code a(errno1(), std::generic_category());
+    for(unsigned long long n = 0; n < iterations; n++)
+    {
+      try
+      {
+        throw std::system_error(a);
+      }
+      catch(const std::system_error &e)
+      {
+        bench::do_not_optimize(e);
+      }
+    }
+  });
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+  for(int n = 1; n < argc; n++)
+  {
+    if(0 == strncmp(argv[n], "--min-time-ms=", 14))
+    {
+      bench::opts().min_time_ms = static_cast<unsigned>(atoi(argv[n] + 14));
+    }
+    else if(0 == strncmp(argv[n], "--filter=", 9))
+    {
+      bench::opts().filter = argv[n] + 9;
+    }
+    else
+    {
+      fprintf(stderr, "Usage: %s [--min-time-ms=N] [--filter=substring]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  bench_construct();
+  bench_erase();
+  bench_failure();
+  bench_equivalent();
+  bench_errc_set();
+  bench_message();
+  bench_format_message();
+  bench_message_threaded();
+  bench_clone();
+  bench_string_ref();
+  bench_result();
+  bench_counters();
+  bench_provenance();
+  bench_flat_map();
+  bench_wire();
+  bench_portable();
+  bench_throw();
+
+  bench::print_json(stdout);
+  return 0;
+}
@@ -22,20 +22,37 @@ Distributed under the Boost Software License, Version 1.0.
 http://www.boost.org/LICENSE_1_0.txt)
 */
 
+#ifdef SYSTEM_ERROR2_TEST_USDT_STUB
+#include <atomic>
+// Counts the tracepoints fired, by standing in for them
+static std::atomic<unsigned> usdt_probe_count_construct, usdt_probe_count_erase, usdt_probe_count_failure, usdt_probe_count_throw, usdt_probe_count_indirect;
+#define SYSTEM_ERROR2_USDT_PROBE(name, id, value) ((void) (id), (void) (value), (void) usdt_probe_count_##name.fetch_add(1, std::memory_order_relaxed))
+#endif
+
 #ifdef _WIN32
 #include "com_code.hpp"
 #else
 #include "getaddrinfo_code.hpp"
 #endif
 
+#include "cached_message_domain.hpp"
+#include "format_support.hpp"
 #include "iostream_support.hpp"
+#include "portable_code.hpp"
+#include "provenance.hpp"
 #include "std_error_code.hpp"
+#include "status_code_counters.hpp"
+#include "status_code_flat_map.hpp"
+#include "status_code_wire.hpp"
 #include "system_error2.hpp"
 
 #include <cstdio>
 #include <cstring>  // for strdup, strlen
 #include <memory>
+#include <new>
 #include <string>
+#include <thread>
+#include <vector>
 
 #ifdef _MSC_VER
 #define strdup _strdup
@@ -236,6 +253,9 @@ inline constexpr const Code_domain_impl &Code_domain_impl::get()
 {
   return Code_domain;
 }
+// A domain registered at build time, as a third party domain would be
+constexpr system_error2::_generic_code_domain Registered_domain(0x3c8e51f0b7a4d296);
+SYSTEM_ERROR2_REGISTER_DOMAIN(Registered_domain);
 // Test make_status_code ADL helper
 struct ADLHelper1
 {
@@ -251,7 +271,51 @@ inline StatusCode make_status_code(ADLHelper1, ADLHelper2)
 {
   return StatusCode(Code::goaway);
 }
+// Test make_status_code_ptr allocator support
+static int counting_allocations;
+template <class T> struct counting_allocator
+{
+  using value_type = T;
+  static constexpr unsigned status_code_ptr_tag = 8;
+  int *live;
+  explicit counting_allocator(int *_live)
+      : live(_live)
+  {
+  }
+  template <class U>
+  counting_allocator(const counting_allocator<U> &o)
+      : live(o.live)
+  {
+  }
+  T *allocate(size_t n)
+  {
+    ++*live;
+    ++counting_allocations;
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+  void deallocate(T *p, size_t /*unused*/) noexcept
+  {
+    --*live;
+    ::operator delete(p);
+  }
+  template <class U> bool operator==(const counting_allocator<U> &o) const noexcept { return live == o.live; }
+  template <class U> bool operator!=(const counting_allocator<U> &o) const noexcept { return live != o.live; }
+};
 
+// Lets the tests exhaust the free store, as seen by the status_code_ptr pool
+static bool fail_nothrow_new;
+void *operator new(size_t bytes, const std::nothrow_t & /*unused*/) noexcept
+{
+  if(fail_nothrow_new)
+  {
+    return nullptr;
+  }
+  return ::operator new(bytes);
+}
+void operator delete(void *p, const std::nothrow_t & /*unused*/) noexcept
+{
+  ::operator delete(p);
+}
 
 int main()
 {
@@ -268,6 +332,9 @@ int main()
   CHECK(!failure1.empty());
   CHECK(success1.success());
   CHECK(failure1.failure());
+#if __cplusplus >= 201402L
+  static_assert(failure1.domain() == generic_code_domain, "domain() of a typed code must be constexpr");
+#endif
   printf("generic_code empty has value %d (%s) is success %d is failure %d\n", static_cast<int>(empty1.value()), empty1.message().c_str(), static_cast<int>(empty1.success()), static_cast<int>(empty1.failure()));
   printf("generic_code success has value %d (%s) is success %d is failure %d\n", static_cast<int>(success1.value()), success1.message().c_str(), static_cast<int>(success1.success()), static_cast<int>(success1.failure()));
   printf("generic_code failure has value %d (%s) is success %d is failure %d\n", static_cast<int>(failure1.value()), failure1.message().c_str(), static_cast<int>(failure1.success()), static_cast<int>(failure1.failure()));
@@ -332,6 +399,74 @@ int main()
     CHECK(0 == strcmp(shared_str3.c_str(), msg));
   }
 
+  // Test atomic_refcounted_block_string_ref with a custom allocator
+  {
+    using string_ref = status_code_domain::string_ref;
+    using block_string_ref = status_code_domain::atomic_refcounted_block_string_ref;
+    struct counting_arena
+    {
+      alignas(std::max_align_t) char buffer[256];
+      int allocations{0}, deallocations{0}, bad_deallocations{0};
+      static void *allocate(void *context, size_t bytes)
+      {
+        auto *self = static_cast<counting_arena *>(context);
+        self->allocations++;
+        return (bytes <= sizeof(self->buffer)) ? self->buffer : nullptr;
+      }
+      static void deallocate(void *context, void *p, size_t /*unused*/)
+      {
+        auto *self = static_cast<counting_arena *>(context);
+        self->deallocations++;
+        self->bad_deallocations += (p != self->buffer) ? 1 : 0;
+      }
+    } arena;
+    const status_code_domain::string_allocator alloc{counting_arena::allocate, counting_arena::deallocate, &arena};
+    const char msg[] = "status test message";
+    {
+      block_string_ref block_str1(msg, static_cast<size_t>(-1), alloc);
+      string_ref block_str2(block_str1);
+      CHECK(arena.allocations == 1);
+      CHECK(block_str1.data() == block_str2.data());
+      CHECK(block_str1.size() == strlen(msg));
+      CHECK(0 == strcmp(block_str2.c_str(), msg));
+      string_ref block_str3(std::move(block_str1));
+      CHECK(block_str1.empty());
+      string_ref block_str4(block_str1);
+      CHECK(block_str4.empty());
+      CHECK(0 == strcmp(block_str3.c_str(), msg));
+    }
+    CHECK(arena.deallocations == 1);
+    CHECK(arena.bad_deallocations == 0);
+    const status_code_domain::string_allocator failing{[](void * /*unused*/, size_t /*unused*/) -> void * { return nullptr; }, [](void * /*unused*/, void * /*unused*/, size_t /*unused*/) {}, nullptr};
+    block_string_ref block_str5(msg, strlen(msg), failing);
+    CHECK(0 == strcmp(block_str5.c_str(), "failed to get message from system"));
+  }
+
+  // Test biased_refcounted_string_ref, with references made and released on other threads
+  {
+    using string_ref = status_code_domain::string_ref;
+    using biased_string_ref = status_code_domain::biased_refcounted_string_ref;
+    const char msg[] = "status test message";
+    auto *biased_str1 = new biased_string_ref(msg);
+    string_ref *biased_str2 = nullptr;
+    std::thread([&] {
+      string_ref copy1(*biased_str1), copy2(copy1);
+      biased_str2 = new string_ref(copy2);
+    }).join();
+    CHECK(biased_str1->data() == biased_str2->data());
+    {
+      string_ref biased_str3(*biased_str2);
+      CHECK(0 == strcmp(biased_str3.c_str(), msg));
+    }
+    // The owner releases all its references, then makes a new one from a reference made elsewhere
+    delete biased_str1;
+    {
+      string_ref biased_str4(*biased_str2);
+      CHECK(0 == strcmp(biased_str4.c_str(), msg));
+    }
+    std::thread([&] { delete biased_str2; }).join();
+  }
+
 #ifdef _WIN32
   // Test win32_code
   constexpr win32_code success5(0 /*ERROR_SUCCESS*/), failure5(0x5 /*ERROR_ACCESS_DENIED*/);
@@ -410,10 +545,27 @@ int main()
 #ifndef SYSTEM_ERROR2_NOT_POSIX
   // Test posix_code
   constexpr posix_code success9(0), failure9(EACCES);
+#if(__cplusplus >= 201402L || _MSVC_LANG >= 201402L) && defined(SYSTEM_ERROR2_HAVE_IS_CONSTANT_EVALUATED)
+  // Comparisons between statically equivalent domains must be constant expressions, so no
+  // virtual function of any domain can be involved
+  static_assert(failure9 == errc::permission_denied, "");
+  static_assert(errc::permission_denied == failure9, "");
+  static_assert(failure9 != errc::no_such_file_or_directory, "");
+  static_assert(failure9 == failure1, "");
+  static_assert(failure1 == failure9, "");
+  static_assert(success9 != failure9, "");
+  static_assert(success9 == posix_code(0), "");
+  static_assert(posix_code() != success9, "");
+  static_assert(posix_code() == generic_code(), "");
+  static_assert(success1 == errc::success, "");
+  static_assert(empty1 != success1, "");
+#endif
   CHECK(success9.success());
   CHECK(failure9.failure());
   printf("\nPOSIX code success has value %d (%s) is success %d is failure %d\n", success9.value(), success9.message().c_str(), static_cast<int>(success9.success()), static_cast<int>(success9.failure()));
   printf("POSIX code failure has value %d (%s) is success %d is failure %d\n", failure9.value(), failure9.message().c_str(), static_cast<int>(failure9.success()), static_cast<int>(failure9.failure()));
+  CHECK(0 == strcmp(failure9.message().c_str(), strerror(EACCES)));  // NOLINT
+  CHECK(posix_code(100000).message().size() > 0);  // beyond any message table
   CHECK(success9 == errc::success);
   CHECK(failure9 == errc::permission_denied);
   CHECK(failure9 == failure1);
@@ -423,6 +575,14 @@ int main()
   CHECK(failure10 == errc::permission_denied);
   CHECK(failure10 == failure1);
   CHECK(failure10 == failure2);
+  CHECK(generic_code_domain.equivalence_is_value_equality());
+  CHECK(posix_code_domain.equivalence_is_value_equality());
+  CHECK(!_posix_code_domain(0x230f170194fcc6c7).equivalence_is_value_equality());
+  system_code failure10a(posix_code(EACCES)), failure10b(posix_code(ENOENT));
+  CHECK(failure10 == failure10a);
+  CHECK(failure10 != failure10b);
+  CHECK(failure10b == system_code(generic_code(errc::no_such_file_or_directory)));
+  CHECK(failure10b != system_code());
 
   // Test error
   error errors[] = {errc::permission_denied, failure1, failure2, std::move(failure3), failure4, failure9, std::move(failure10)};
@@ -432,7 +592,31 @@ int main()
     printf("error[%zu] has domain %s value %zd (%s) and errc::permission_denied == error = %d\n", n, errors[n].domain().name().c_str(), errors[n].value(), errors[n].message().c_str(), static_cast<int>(errc::permission_denied == errors[n]));
     CHECK(errors[n] == errc::permission_denied);
   }
+  // error caches that it is a failure, and that survives moves and clones
+  CHECK(errors[5].failure());
+  CHECK(errors[5].domain() == posix_code_domain);
+  system_code failure12(std::move(errors[5]));
+  CHECK(failure12.failure());
+  CHECK(failure12 == errc::permission_denied);
+  CHECK(failure12.clone().failure());
+  // as does erasing a failure without going through error
+  system_code failure13(failure9);
+  CHECK(failure13.failure() && !failure13.success());
+  CHECK(failure13.domain() == posix_code_domain);
+  CHECK(failure13 == errc::permission_denied);
+  CHECK(posix_code(failure13) == failure9);
+  error failure14(std::move(failure13));
+  CHECK(failure14.failure());
+  CHECK(posix_code(failure12) == errc::permission_denied);
 #endif
+  // but only domains which can say so without a virtual function call are asked upon erasure
+  static_assert(detail::caches_failure_when_erased<_generic_code_domain>::value, "");
+  static_assert(!detail::caches_failure_when_erased<Code_domain_impl>::value, "");
+  static_assert(!detail::caches_failure_when_erased<erased<intptr_t>>::value, "");
+  {
+    system_code failure12(failure2);
+    CHECK(failure12.failure() && !failure12.success());
+  }
 
   // Test ADL implicit construction
   StatusCode sc1(make_status_code(ADLHelper1{})), sc2(make_status_code(ADLHelper1{}, ADLHelper2{}));
@@ -468,6 +652,572 @@ int main()
   CHECK(*get_if<posix_code>(&success11) == success9);
   CHECK(get_if<StatusCode>(&success11) == nullptr);
   CHECK(get_id(success11) == success9.domain().id());
+
+  // Test status_code_ptr with a custom allocator, which is used for copies too
+  {
+    int live = 0;
+    {
+      system_code failure12(make_status_code_ptr(failure9, counting_allocator<posix_code>(&live)));
+      CHECK(live == 1);
+      CHECK(*get_if<posix_code>(&failure12) == failure9);
+      CHECK(get_id(failure12) == failure9.domain().id());
+      CHECK(failure12.domain() != failure11.domain());
+      // Ids are derived only from the indirected domain's id and the allocator's tag, so do not vary by compiler
+      CHECK(system_code(make_status_code_ptr(failure9, std::allocator<posix_code>())).domain().id() == (0xc44f7bdeb2cc50e9 ^ failure9.domain().id() ^ 1));
+      CHECK(failure12 == failure11);
+      CHECK(failure12.message().c_str() == std::string(failure9.message().c_str()));
+      system_code failure13(failure12.clone());
+      CHECK(live == 2);
+      CHECK(counting_allocations == 2);
+      CHECK(*get_if<posix_code>(&failure13) == failure9);
+    }
+    CHECK(live == 0);
+  }
+  // Pooled blocks may be released by a different thread to the allocating one
+  {
+    system_code failure12(make_status_code_ptr(failure9));
+    std::thread([&] {
+      system_code failure13(failure12.clone());
+      CHECK(*get_if<posix_code>(&failure13) == failure9);
+      system_code released(std::move(failure12));
+    }).join();
+    system_code failure13(make_status_code_ptr(failure9));
+    CHECK(*get_if<posix_code>(&failure13) == failure9);
+  }
+  // Blocks claimed from the emergency reserve are returned to it, not kept by the releasing thread
+  {
+    using pool = detail::status_code_ptr_pool<64, alignof(std::max_align_t)>;
+    void *blocks[SYSTEM_ERROR2_STATUS_CODE_PTR_RESERVE];
+    fail_nothrow_new = true;
+    for(auto &b : blocks)
+    {
+      b = pool::allocate();
+      CHECK(b != nullptr);
+    }
+    CHECK(pool::allocate() == nullptr);
+    for(auto *b : blocks)
+    {
+      pool::deallocate(b);
+    }
+    std::thread([&] {
+      for(auto &b : blocks)
+      {
+        b = pool::allocate();
+        CHECK(b != nullptr);
+      }
+      for(auto *b : blocks)
+      {
+        pool::deallocate(b);
+      }
+    }).join();
+    fail_nothrow_new = false;
+  }
+  // Test shared status_code_ptr, whose clones share the indirected status code
+  {
+    int live = 0;
+    {
+      system_code failure12(make_shared_status_code_ptr(failure9, counting_allocator<posix_code>(&live)));
+      CHECK(live == 1);
+      CHECK(failure12 == failure11);
+      CHECK(get_id(failure12) == failure9.domain().id());
+      // Payloads owned differently, or from different allocators, have different domain ids
+      CHECK(failure12.domain() != failure11.domain());
+      CHECK(failure12.domain() != system_code(make_status_code_ptr(failure9, counting_allocator<posix_code>(&live))).domain());
+      CHECK(failure12.domain() != system_code(make_shared_status_code_ptr(failure9)).domain());
+      system_code failure13(failure12.clone());
+      CHECK(live == 1);
+      CHECK(get_if<posix_code>(&failure13) == get_if<posix_code>(&failure12));
+      CHECK(*get_if<posix_code>(&failure13) == failure9);
+      std::thread([&] { system_code failure14(failure12.clone()); }).join();
+      {
+        system_code released(std::move(failure12));
+      }
+      CHECK(live == 1);
+      CHECK(failure13.message().c_str() == std::string(failure9.message().c_str()));
+    }
+    CHECK(live == 0);
+    error failure12(make_shared_status_code_ptr(failure9));
+    CHECK(*get_if<posix_code>(&failure12) == failure9);
+  }
+  // Test make_status_code_erased, which only indirects when the value type does not fit
+  {
+    system_code failure12(make_status_code_erased(failure9));
+    CHECK(get_if<posix_code>(&failure12) == nullptr);
+    CHECK(failure12.domain() == failure9.domain());
+    CHECK(failure12 == failure9);
+    std_error_code ec(std::make_error_code(std::errc::permission_denied));
+    system_code failure13(make_status_code_erased(ec));
+    CHECK(get_if<std_error_code>(&failure13) != nullptr);
+    CHECK(failure13 == errc::permission_denied);
+  }
+  // Test system_code_wide, which holds larger value types in place, and converts to and from system_code
+  {
+    std_error_code ec(std::make_error_code(std::errc::permission_denied));
+    system_code_wide failure12(ec);
+    CHECK(failure12.domain() == ec.domain());
+    CHECK(failure12 == errc::permission_denied);
+    CHECK(failure12.message().c_str() == std::string(ec.message().c_str()));
+    system_code_wide failure13(failure12.clone());
+    CHECK(failure13 == failure12);
+    system_code failure14(make_status_code_ptr(std::move(failure13)));
+    CHECK(failure14 == errc::permission_denied);
+    CHECK(errc::permission_denied == failure14);
+    CHECK(failure14.message().c_str() == std::string(ec.message().c_str()));
+    system_code failure15(failure14.clone());
+    CHECK(failure15 == failure12);
+    error_wide failure16(std::move(failure15));
+    CHECK(failure16 == errc::permission_denied);
+    error failure17(make_status_code_ptr(system_code_wide(std::move(failure16))));
+    CHECK(failure17 == errc::permission_denied);
+    // Payloads of different sizes have different domain ids
+    CHECK(failure17.domain() != system_code(make_status_code_ptr(system_code(posix_code(EDOM)))).domain());
+    CHECK(failure17.domain() == system_code(make_status_code_ptr(system_code_wide(posix_code(EDOM)))).domain());
+  }
+  // Test the occurrence counters, which are shared between threads
+  {
+    status_code_counters::reset();
+    auto count_of = [](const status_code_domain &domain, intptr_t value) -> uint64_t {
+      for(const auto &e : status_code_counters::snapshot())
+      {
+        if(e.domain->id() == domain.id() && e.value == value)
+        {
+          return e.count;
+        }
+      }
+      return 0;
+    };
+    posix_code failure12(EDOM), failure13(ERANGE);
+    status_code_counters::record(failure12);
+    status_code_counters::record(failure12);
+    status_code_counters::record(system_code(failure13));
+    status_code_counters::record(posix_code());
+    CHECK(count_of(posix_code_domain, EDOM) == 2);
+    CHECK(count_of(posix_code_domain, ERANGE) == 1);
+    std::vector<std::thread> threads;
+    for(int n = 0; n < 4; n++)
+    {
+      threads.emplace_back([&] {
+        for(int i = 0; i < 1000; i++)
+        {
+          status_code_counters::record(failure12);
+        }
+      });
+    }
+    for(auto &t : threads)
+    {
+      t.join();
+    }
+    CHECK(count_of(posix_code_domain, EDOM) == 4002);
+    char line[128];
+    snprintf(line, sizeof(line), "status_code_failures_total{domain=\"posix domain\",domain_id=\"0x%016llx\",value=\"%d\"} 4002\n", static_cast<unsigned long long>(posix_code_domain.id()), EDOM);
+    CHECK(status_code_counters::prometheus_text().find(line) != std::string::npos);
+    CHECK(status_code_counters::dropped() == 0);
+#ifdef SYSTEM_ERROR2_ERROR_COUNTERS
+    // Constructing a failure records it
+    error failure14{failure13};
+    CHECK(count_of(posix_code_domain, ERANGE) == 2);
+    // once only, whether made by ADL or converted after it became a failure
+    error failure15 = errc::no_link;
+    CHECK(count_of(generic_code_domain, static_cast<intptr_t>(errc::no_link)) == 1);
+    errored_status_code<_generic_code_domain> failure16(errc::no_buffer_space);
+    error failure17(std::move(failure16)), failure18(failure16);
+    CHECK(count_of(generic_code_domain, static_cast<intptr_t>(errc::no_buffer_space)) == 1);
+    const errored_status_code<_generic_code_domain> failure19(failure15);
+    CHECK(count_of(generic_code_domain, static_cast<intptr_t>(errc::no_link)) == 2);
+#endif
+    CHECK(status_code_counters::prometheus_text().find("# TYPE status_code_failures_total_dropped counter\nstatus_code_failures_total_dropped 0\n") != std::string::npos);
+    // Reset shards are zeroed by their owners, so counting resumes from zero
+    status_code_counters::reset();
+    CHECK(count_of(posix_code_domain, EDOM) == 0);
+    status_code_counters::record(failure12);
+    std::thread([&] { status_code_counters::record(failure12); }).join();
+    CHECK(count_of(posix_code_domain, EDOM) == 2);
+    status_code_counters::reset();
+    CHECK(count_of(posix_code_domain, EDOM) == 0);
+  }
+#ifdef SYSTEM_ERROR2_TEST_USDT_STUB
+  // Test each failure fires the failure tracepoint once, however it is then converted
+  {
+    const unsigned before = usdt_probe_count_failure.load();
+    error failure12 = errc::no_link;
+    CHECK(usdt_probe_count_failure.load() - before == 1);
+    errored_status_code<_generic_code_domain> failure13(errc::no_buffer_space);
+    error failure14(std::move(failure13)), failure15(failure13);
+    CHECK(usdt_probe_count_failure.load() - before == 2);
+  }
+#endif
+  // Test provenance is captured, shared by copies, and does not change comparisons
+  {
+    const unsigned rate = provenance_sample_rate();
+    set_provenance_sample_rate(1);
+    const unsigned line = __LINE__ + 1;
+    system_code failure12(with_provenance(posix_code(EDOM)));
+    set_provenance_sample_rate(rate);
+    CHECK(sizeof(failure12) == 2 * sizeof(void *));
+    const status_code_provenance *p = get_provenance(failure12);
+    CHECK(p != nullptr);
+#ifdef SYSTEM_ERROR2_HAVE_SOURCE_LOCATION
+    CHECK(p->location.line == line);
+    CHECK(p->location.file != nullptr && strstr(p->location.file, "main.cpp") != nullptr);
+#else
+    printf("Skipping provenance location checks, as this compiler cannot supply the caller's location\n");
+    CHECK(p->location.line == 0 && p->location.file == nullptr);
+    (void) line;
+#endif
+#if SYSTEM_ERROR2_PROVENANCE_BACKTRACE
+    CHECK(p->frames > 0);
+#endif
+    CHECK(failure12 == posix_code(EDOM));
+    CHECK(posix_code(EDOM) == failure12);
+    CHECK(failure12 == errc::argument_out_of_domain);
+    CHECK(failure12.message().c_str() == std::string(posix_code(EDOM).message().c_str()));
+    system_code failure13(failure12.clone());
+    CHECK(get_provenance(failure13) == p);
+    CHECK(failure13 == failure12);
+    error failure14(with_provenance(posix_code(ERANGE)));
+    CHECK(failure14 != failure12);
+    CHECK(get_provenance(failure14) != nullptr);
+    CHECK(get_provenance(system_code(posix_code(EDOM))) == nullptr);
+    CHECK(get_provenance(with_provenance(posix_code(0))) == nullptr);
+  }
+  // Test domains can be found by id, whether registered at build time, when first used, or at runtime
+  {
+    CHECK(find_domain(generic_code_domain.id()) != nullptr && *find_domain(generic_code_domain.id()) == generic_code_domain);
+    CHECK(find_domain(posix_code_domain.id()) != nullptr && *find_domain(posix_code_domain.id()) == posix_code_domain);
+    CHECK(find_domain(getaddrinfo_code_domain.id()) != nullptr);
+    CHECK(find_domain(std_error_code_domain.id()) != nullptr);
+    CHECK(find_domain(Registered_domain.id()) != nullptr && find_domain(Registered_domain.id())->name().c_str() == std::string("generic domain"));
+    // Indirecting domains are registered during static initialisation, before any code of theirs is made
+    CHECK(find_domain(detail::indirecting_domain<getaddrinfo_code, status_code_ptr_allocator<getaddrinfo_code>>::get().id()) != nullptr);
+    system_code failure12(make_status_code_ptr(posix_code(EDOM)));
+    CHECK(find_domain(failure12.domain().id()) != nullptr && *find_domain(failure12.domain().id()) == failure12.domain());
+    CHECK(find_domain(system_code(make_status_code_ptr(getaddrinfo_code(EAI_AGAIN))).domain().id()) != nullptr);
+    static const _generic_code_domain plugin_domain(0x5f1c2ab4e7d09a31);
+    CHECK(find_domain(plugin_domain.id()) == nullptr);
+    CHECK(register_domain(plugin_domain));
+    CHECK(register_domain(plugin_domain));
+    CHECK(find_domain(plugin_domain.id()) == &plugin_domain);
+    CHECK(register_module_domains() >= 2 || !SYSTEM_ERROR2_HAVE_DOMAIN_REGISTRY_SECTION);
+  }
+  // Test messages are memoised, even for domains with final overrides, and the cache's use is counted
+  {
+    using cached_domain = cached_message_domain<Code_domain_impl>;
+    const status_code<cached_domain> failure17(Code::goaway);
+    CHECK(0 == strcmp(failure17.message().c_str(), "goaway"));
+    CHECK(0 == strcmp(failure17.message().c_str(), "goaway"));
+    char buffer[16];
+    CHECK(failure17.format_message_to(buffer, sizeof(buffer)) == 6 && 0 == strcmp(buffer, "goaway"));
+    CHECK(0 == strcmp(system_code(failure17).message().c_str(), "goaway"));
+    CHECK(failure17.failure() && failure17 == StatusCode(Code::goaway) && failure17 != StatusCode(Code::error2));
+    CHECK(failure17.domain() == Code_domain && 0 == strcmp(failure17.domain().name().c_str(), "Code_category_impl"));
+    auto stats = cached_domain::statistics();
+    CHECK(stats.hits == 3 && stats.misses == 1 && stats.evictions == 0 && stats.hit_ratio() == 0.75);
+
+    // A cache of one set, evicted from concurrently by more values than it holds
+    using small_domain = cached_message_domain<_posix_code_domain, 4>;
+    // which is never registered, so lookups by its id find the wrapped domain
+    CHECK(find_domain(small_domain::get().id()) == &_posix_code_domain::get());
+    const int errnos[] = {EDOM, ERANGE, ENOENT, EACCES, EINVAL, EEXIST, EPERM, EBADF};
+    for(int e : errnos)
+    {
+      CHECK(0 == strcmp(status_code<small_domain>(e).message().c_str(), posix_code(e).message().c_str()));
+    }
+    stats = small_domain::statistics();
+    CHECK(stats.misses == 8 && stats.evictions == 4);
+    std::atomic<bool> allcorrect(true);
+    std::vector<std::thread> threads;
+    for(size_t t = 0; t < 4; t++)
+    {
+      threads.emplace_back([&, t] {
+        for(size_t n = 0; n < 20000; n++)
+        {
+          const int e = errnos[(n + t) % 8];
+          if(0 != strcmp(status_code<small_domain>(e).message().c_str(), posix_code(e).message().c_str()))
+          {
+            allcorrect = false;
+          }
+        }
+      });
+    }
+    for(auto &t : threads)
+    {
+      t.join();
+    }
+    CHECK(allcorrect);
+    stats = small_domain::statistics();
+    CHECK(stats.hits + stats.misses == 80008 && stats.hits > 0 && stats.uncacheable == 0);
+  }
+  // Test static message views, whose table offsets and lengths must agree with the blob
+  {
+    bool allconsistent = true;
+    for(const auto &e : detail::generic_code_messages<>::entries)
+    {
+      const auto view = generic_code(e.code).message_view();
+      allconsistent = allconsistent && view.size() == e.length && strlen(view.c_str()) == e.length && 0 == strcmp(view.c_str(), generic_code(e.code).message().c_str());
+    }
+    CHECK(allconsistent);
+    for(const auto &e : detail::getaddrinfo_code_messages<>::entries)
+    {
+      const auto view = getaddrinfo_code(e.code).message_view();
+      allconsistent = allconsistent && view.size() == e.length && strlen(view.c_str()) == e.length;
+    }
+    CHECK(allconsistent);
+    const auto view1 = generic_code(errc::argument_out_of_domain).message_view();
+    CHECK(view1.size() == 32 && 0 == strcmp(view1.c_str(), "Numerical argument out of domain"));
+    CHECK(generic_code(errc::unknown).message_view().size() == 7);
+    CHECK(system_code().message_view().size() == 7 && 0 == strcmp(system_code().message_view().c_str(), "(empty)"));
+    CHECK(0 == strcmp(getaddrinfo_code(EAI_NONAME).message_view().c_str(), "Name or service not known"));
+    CHECK(getaddrinfo_code(12345).message_view().data() == nullptr);
+    CHECK(with_provenance(generic_code(errc::argument_out_of_domain)).message_view().data() == view1.data());
+    CHECK(system_code(make_status_code_ptr(generic_code(errc::argument_out_of_domain))).message_view().data() == view1.data());
+#ifdef SYSTEM_ERROR2_POSIX_MESSAGE_TABLE
+    CHECK(0 == strcmp(posix_code(EDOM).message_view().c_str(), posix_code(EDOM).message().c_str()));
+#else
+    CHECK(posix_code(EDOM).message_view().data() == nullptr);
+#endif
+  }
+  // Test messages format into caller buffers, truncating like snprintf()
+  {
+    char buffer[64];
+    CHECK(generic_code(errc::argument_out_of_domain).format_message_to(buffer, sizeof(buffer)) == 32);
+    CHECK(0 == strcmp(buffer, "Numerical argument out of domain"));
+    CHECK(system_code().format_message_to(buffer, sizeof(buffer)) == 7 && 0 == strcmp(buffer, "(empty)"));
+    CHECK(posix_code(EDOM).format_message_to(buffer, 10) == 32 && 0 == strcmp(buffer, "Numerical"));
+    CHECK(posix_code(EDOM).format_message_to(buffer, 0) == 32);
+    CHECK(posix_code(EDOM).format_message_to(buffer, 1) == 32 && buffer[0] == 0);
+    CHECK(posix_code(-5).format_message_to(buffer, sizeof(buffer)) == 16 && 0 == strcmp(buffer, "Unknown error -5"));
+    CHECK(getaddrinfo_code(EAI_NONAME).format_message_to(buffer, sizeof(buffer)) == 25 && 0 == strcmp(buffer, "Name or service not known"));
+    CHECK(with_provenance(posix_code(EDOM)).format_message_to(buffer, sizeof(buffer)) == 32 && 0 == strcmp(buffer, "Numerical argument out of domain"));
+    CHECK(system_code(make_status_code_ptr(posix_code(EDOM))).format_message_to(buffer, sizeof(buffer)) == 32 && 0 == strcmp(buffer, "Numerical argument out of domain"));
+#ifdef SYSTEM_ERROR2_POSIX_MESSAGE_TABLE
+    // With the message table, POSIX codes format exactly what message() returns
+    CHECK(posix_code(ENOENT).format_message_to(buffer, sizeof(buffer)) == strlen(posix_code(ENOENT).message().c_str()) && 0 == strcmp(buffer, posix_code(ENOENT).message().c_str()));
+#endif
+    // Domains without an override fall back onto message()
+    const StatusCode failure16(Code::success1);
+    CHECK(failure16.format_message_to(buffer, sizeof(buffer)) == strlen(failure16.message().c_str()) && 0 == strcmp(buffer, failure16.message().c_str()));
+    CHECK(format_status_code_to(posix_code(EDOM), buffer, sizeof(buffer)) == 46 && 0 == strcmp(buffer, "posix domain: Numerical argument out of domain"));
+    CHECK(format_status_code_to(posix_code(EDOM), buffer, 14) == 46 && 0 == strcmp(buffer, "posix domain:"));
+    CHECK(format_status_code_to(posix_code(EDOM), buffer, 16) == 46 && 0 == strcmp(buffer, "posix domain: N"));
+    CHECK(format_status_code_to(system_code(), buffer, sizeof(buffer)) == 7 && 0 == strcmp(buffer, "(empty)"));
+  }
+  // Test portable codes survive being copied as bytes, and resolve their domain lazily
+  {
+    static_assert(std::is_trivially_copyable<portable_code>::value, "");
+    CHECK(portable_code().empty() && portable_code().to_system_code().empty());
+    CHECK(portable_code(system_code()).empty());
+    const portable_code p1(posix_code(EDOM));
+    CHECK(p1.id() == posix_code_domain.id() && p1.value() == EDOM);
+    unsigned char shm[sizeof(portable_code)];
+    memcpy(shm, &p1, sizeof(p1));
+    portable_code p2;
+    memcpy(&p2, shm, sizeof(p2));
+    CHECK(p2 == p1 && p2.domain() == &posix_code_domain);
+    system_code failure15 = p2.to_system_code();
+    CHECK(exact_equal()(failure15, system_code(posix_code(EDOM))));
+    CHECK(portable_code(failure15) == p1);
+    CHECK(portable_code(with_provenance(posix_code(EDOM))) == p1);
+    CHECK(portable_code(generic_code(errc::timed_out)).to_system_code() == errc::timed_out);
+    CHECK(exact_equal()(portable_code(getaddrinfo_code(-3)).to_system_code(), system_code(getaddrinfo_code(-3))));
+    const portable_code p3(0x1234567890abcdefULL, 5);
+    CHECK(p3 != p1 && p3.domain() == nullptr && p3.to_system_code().empty());
+    // Codes of domains whose values are pointers are never rebuilt from what may be forged
+    const system_code failure16(make_status_code_ptr(posix_code(EDOM)));
+    CHECK(portable_code(failure16.domain().id(), 0x41414140).domain() == &failure16.domain());
+    CHECK(portable_code(failure16.domain().id(), 0x41414140).to_system_code().empty());
+    CHECK(portable_code(with_provenance(posix_code(EDOM)).domain().id(), 0x41414140).to_system_code().empty());
+  }
+  // Test the wire format round trips, with errc numbered portably
+  {
+    CHECK(to_portable_errc(errc::success) == 0 && from_portable_errc(0) == errc::success);
+    CHECK(to_portable_errc(errc::address_family_not_supported) == 1);
+    CHECK(from_portable_errc(6) == errc::argument_out_of_domain);
+    CHECK(to_portable_errc(errc::unknown) == -1 && from_portable_errc(1000) == errc::unknown);
+    bool allroundtrip = true;
+    for(unsigned n = 1; n <= 77; n++)
+    {
+      allroundtrip = allroundtrip && from_portable_errc(static_cast<unsigned>(to_portable_errc(from_portable_errc(n)))) == from_portable_errc(n);
+    }
+    CHECK(allroundtrip);
+    unsigned char buffer[status_code_wire_max_size];
+    system_code out;
+    CHECK(encode_status_code(generic_code(errc::argument_out_of_domain), buffer, sizeof(buffer)) == 2);
+    CHECK(buffer[0] == 1 && buffer[1] == 6);
+    CHECK(decode_status_code(out, buffer, 2) == 2 && out.domain() == generic_code_domain && out == errc::argument_out_of_domain);
+    CHECK(encode_status_code(system_code(posix_code(EDOM)), buffer, sizeof(buffer)) == 2 && buffer[0] == 2);
+    CHECK(decode_status_code(out, buffer, 2) == 2 && out.domain() == posix_code_domain && exact_equal()(out, system_code(posix_code(EDOM))));
+    CHECK(encode_status_code(with_provenance(posix_code(ERANGE)), buffer, sizeof(buffer)) == 2);
+    CHECK(decode_status_code(out, buffer, 2) == 2 && out.domain() == posix_code_domain && out == posix_code(ERANGE));
+    CHECK(encode_status_code(system_code(), buffer, sizeof(buffer)) == 1 && decode_status_code(out, buffer, 1) == 1 && out.empty());
+    const size_t bytes = encode_status_code(getaddrinfo_code(-3), buffer, sizeof(buffer));
+    CHECK(bytes == 10 && buffer[0] == 3);
+    CHECK(decode_status_code(out, buffer, bytes) == bytes && exact_equal()(out, system_code(getaddrinfo_code(-3))));
+    CHECK(decode_status_code(out, buffer, bytes - 1) == 0);
+    CHECK(encode_status_code(getaddrinfo_code(-3), buffer, 9) == 0);
+    buffer[1] ^= 0xff;
+    CHECK(decode_status_code(out, buffer, bytes) == 0);
+    buffer[0] = 7;
+    CHECK(decode_status_code(out, buffer, bytes) == 0);
+    // Frames naming domains whose values are pointers are malformed, whatever their value
+    const auto forge = [&buffer](unsigned long long id) {
+      buffer[0] = 3;
+      for(unsigned n = 0; n < 8; n++)
+      {
+        buffer[1 + n] = static_cast<unsigned char>(id >> (8 * n));
+      }
+      // 0x41414140 zigzag encoded
+      const unsigned char value[] = {0x80, 0x85, 0x8a, 0x94, 0x08};
+      memcpy(buffer + 9, value, sizeof(value));
+      return size_t(14);
+    };
+    CHECK(decode_status_code(out, buffer, forge(getaddrinfo_code_domain.id())) == 14 && out.domain() == getaddrinfo_code_domain && out.value() == 0x41414140);
+    CHECK(decode_status_code(out, buffer, forge(detail::indirecting_domain<posix_code, status_code_ptr_allocator<posix_code>>::get().id())) == 0);
+    CHECK(decode_status_code(out, buffer, forge(system_code(make_shared_status_code_ptr(posix_code(EDOM))).domain().id())) == 0);
+    CHECK(decode_status_code(out, buffer, forge(with_provenance(posix_code(EDOM)).domain().id())) == 0);
+  }
+  // Test membership of sets of errc, which maps to generic code once
+  {
+    constexpr errc_set transient{errc::timed_out, errc::resource_unavailable_try_again, errc::interrupted, errc::connection_reset};
+    static_assert(transient.contains(errc::interrupted), "");
+    static_assert(!transient.contains(errc::argument_out_of_domain), "");
+    static_assert(!transient.contains(errc::unknown), "");
+    static_assert(!errc_set().contains(errc::success) && errc_set().empty(), "");
+    static_assert((transient | errc_set(errc::argument_out_of_domain)).contains(errc::argument_out_of_domain), "");
+    static_assert((transient & errc_set(errc::interrupted, errc::argument_out_of_domain)) == errc_set(errc::interrupted), "");
+    CHECK(posix_code(ETIMEDOUT).in(transient));
+    CHECK(!posix_code(EDOM).in(transient));
+    CHECK(generic_code(errc::interrupted).in(transient));
+    CHECK(system_code(posix_code(ECONNRESET)).in(transient));
+    CHECK(error(generic_code(errc::interrupted)).in(transient));
+    CHECK(!system_code().in(transient));
+    CHECK(!posix_code(EDOM).in(errc_set()));
+  }
+  // Test a registered equivalence function decides cross domain equivalence in both directions
+  {
+    static int calls;
+    auto posix_vs_generic = [](const status_code<void> &code1, const status_code<void> &code2) {
+      ++calls;
+      return static_cast<const posix_code &>(code1).value() == static_cast<int>(static_cast<const generic_code &>(code2).value());  // NOLINT
+    };
+    system_code failure12(posix_code(EDOM)), failure13(generic_code(errc::argument_out_of_domain)), failure14(generic_code(errc::result_out_of_range));
+    CHECK(register_equivalence(posix_code_domain, generic_code_domain, posix_vs_generic));
+    CHECK(!register_equivalence(posix_code_domain, posix_code_domain, posix_vs_generic));
+    CHECK(failure12 == failure13);
+    CHECK(failure13 == failure12);
+    CHECK(failure12 != failure14);
+    CHECK(calls == 3);
+    CHECK(failure12 == system_code(posix_code(EDOM)));
+    CHECK(calls == 3);
+    // Typed comparisons of statically equivalent domains give the same answer as erased ones
+    const posix_code failure15(EDOM);
+    const generic_code failure16(errc::argument_out_of_domain);
+    CHECK((failure15 == failure16) == (failure12 == failure13) && calls == 5);
+    CHECK((failure16 != failure15) == (failure13 != failure12) && calls == 7);
+    CHECK(failure15 == posix_code(EDOM) && calls == 7);
+    CHECK(register_equivalence(posix_code_domain, generic_code_domain, [](const status_code<void> & /*unused*/, const status_code<void> & /*unused*/) { return false; }));
+    CHECK(failure15 != failure16 && failure12 != failure13);
+    CHECK(register_equivalence(posix_code_domain, generic_code_domain, nullptr));
+    CHECK(failure15 == failure16 && failure12 == failure13);
+    CHECK(calls == 7);
+  }
+  // Test exact comparison, which unlike semantic comparison distinguishes domains
+  {
+    system_code failure12(posix_code(EDOM)), failure13(posix_code(EDOM)), failure14(generic_code(errc::argument_out_of_domain)), failure15(posix_code(ERANGE)), empty1, empty2;
+    CHECK(failure12 == failure14);
+    CHECK(exact_equal()(failure12, failure13));
+    CHECK(!exact_equal()(failure12, failure14));
+    CHECK(!exact_equal()(failure12, failure15));
+    CHECK(!exact_equal()(failure12, empty1));
+    CHECK(exact_equal()(empty1, empty2));
+    CHECK(exact_hash()(failure12) == exact_hash()(failure13));
+    CHECK(exact_hash()(failure12) != exact_hash()(failure15));
+    CHECK(exact_hash()(empty1) == 0);
+    CHECK(!exact_less()(failure12, failure13) && !exact_less()(failure13, failure12));
+    CHECK(exact_less()(failure12, failure14) != exact_less()(failure14, failure12));
+    CHECK(exact_less()(failure12, failure15) != exact_less()(failure15, failure12));
+    CHECK(exact_less()(empty1, failure12) && !exact_less()(failure12, empty1) && !exact_less()(empty1, empty2));
+  }
+  // Test the flat map, including erasure from long probe sequences
+  {
+    status_code_flat_map<system_code, int> map;
+    CHECK(map.empty());
+    CHECK(map.find(posix_code(EDOM)) == map.end());
+    system_code failure12(posix_code(EDOM));
+    ++map[failure12];
+    ++map[failure12];
+    ++map[system_code(generic_code(errc::argument_out_of_domain))];
+    CHECK(map.size() == 2);
+    CHECK(map[failure12] == 2);
+    CHECK(map.find(posix_code(EDOM))->second == 2);
+    CHECK(map.count(generic_code(errc::argument_out_of_domain)) == 1);
+    CHECK(!map.try_emplace(posix_code(EDOM), 5).second);
+    CHECK(map.try_emplace(posix_code(ERANGE), 5).second);
+    CHECK(map[posix_code(ERANGE)] == 5);
+    for(int n = 1; n <= 1000; n++)
+    {
+      map[posix_code(1000 + n)] = n;
+    }
+    CHECK(map.size() == 1003);
+    CHECK(map.capacity() >= 1003);
+    for(int n = 1; n <= 1000; n += 2)
+    {
+      CHECK(map.erase(posix_code(1000 + n)) == 1);
+    }
+    CHECK(map.erase(posix_code(1001)) == 0);
+    CHECK(map.size() == 503);
+    bool allfound = true;
+    for(int n = 2; n <= 1000; n += 2)
+    {
+      auto it = map.find(posix_code(1000 + n));
+      allfound = allfound && it != map.end() && it->second == n && !map.contains(posix_code(999 + n));
+    }
+    CHECK(allfound);
+    size_t items = 0;
+    for(const auto &i : map)
+    {
+      (void) i;
+      ++items;
+    }
+    CHECK(items == map.size());
+    status_code_flat_map<system_code, int> map2(map);
+    CHECK(map2.size() == 503 && map2[posix_code(EDOM)] == 2);
+    map.clear();
+    CHECK(map.empty() && map.find(posix_code(EDOM)) == map.end());
+    map = std::move(map2);
+    CHECK(map.size() == 503);
+  }
+#ifdef SYSTEM_ERROR2_FLIGHT_RECORDER
+  // Test the flight recorder remembers failures per thread, including of exited threads
+  {
+    std::thread([] { error failure12{posix_code(EDOM)}; }).join();
+    error failure13{posix_code(ERANGE)};
+    // Each failure takes one slot, and codes whose values are pointers are recorded without them
+    errored_status_code<_posix_code_domain> failure14(EXDEV);
+    error failure15(std::move(failure14));
+    error failure16{make_status_code_ptr(posix_code(EDOM))};
+    FILE *f = tmpfile();
+    flight_recorder_dump(fileno(f));
+    rewind(f);
+    std::string dump;
+    char buffer[256];
+    size_t bytes;
+    while((bytes = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    {
+      dump.append(buffer, bytes);
+    }
+    fclose(f);
+    char line[128];
+    snprintf(line, sizeof(line), "domain=0x%016llx value=%d\n", static_cast<unsigned long long>(posix_code_domain.id()), EDOM);
+    CHECK(dump.find(line) != std::string::npos);
+    CHECK(dump.find(" (thread exited):\n") != std::string::npos);
+    snprintf(line, sizeof(line), "domain=0x%016llx value=%d\n", static_cast<unsigned long long>(posix_code_domain.id()), ERANGE);
+    CHECK(dump.find(line) != std::string::npos);
+    snprintf(line, sizeof(line), "domain=0x%016llx value=%d\n", static_cast<unsigned long long>(posix_code_domain.id()), EXDEV);
+    CHECK(dump.find(line) != std::string::npos && dump.find(line) == dump.rfind(line));
+    snprintf(line, sizeof(line), "domain=0x%016llx value=0\n", static_cast<unsigned long long>(failure16.domain().id()));
+    CHECK(dump.find(line) != std::string::npos);
+  }
+#endif
 #endif
 
   return retcode;
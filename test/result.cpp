@@ -198,7 +198,7 @@ int main()
 
     result<int> a(5);
     result<int> b(generic_code{errc::invalid_argument});
-    std::cout << sizeof(a) << std::endl;  // 32 bytes
+    std::cout << sizeof(a) << std::endl;  // 16 bytes
     if(false)                             // NOLINT
     {
       b.assume_value();
@@ -277,6 +277,56 @@ int main()
     BOOST_CHECK(b.error() == errc::invalid_argument);
   }
 
+  // Test the niche: no discriminant, and moving the error out does not make a value
+  {
+    static_assert(sizeof(result<int>) == sizeof(error), "");
+    static_assert(sizeof(result<void>) == sizeof(error), "");
+    static_assert(sizeof(result<void *>) == sizeof(error), "");
+    static_assert(traits::is_move_bitcopying<result<int>>::value, "");
+    static_assert(!traits::is_move_bitcopying<result<std::string>>::value, "");
+    result<std::string> a(generic_code{errc::invalid_argument});
+    error e(std::move(a).error());
+    BOOST_CHECK(e == errc::invalid_argument);
+    BOOST_CHECK(a.has_error());
+    BOOST_CHECK(!a.has_value());
+    result<std::string> b(std::move(a));
+    BOOST_CHECK(b.has_error());
+  }
+  // Test move assignment across states, and swap
+  {
+    result<std::string> a("niall"), b(generic_code{errc::invalid_argument});
+    a.swap(b);
+    BOOST_CHECK(a.has_error());
+    BOOST_CHECK(a.error() == errc::invalid_argument);
+    BOOST_CHECK(b.value() == "niall");
+    a = std::move(b);
+    BOOST_CHECK(a.value() == "niall");
+    b = result<std::string>(generic_code{errc::no_link});
+    a = std::move(b);
+    BOOST_CHECK(a.error() == errc::no_link);
+    result<int> c(5), d(5), f(6), g(generic_code{errc::no_link});
+    BOOST_CHECK(c == d);
+    BOOST_CHECK(c != f);
+    BOOST_CHECK(c != g);
+    BOOST_CHECK(g.error() == a.error());
+    BOOST_CHECK(g == g.clone());
+    // Self move assignment leaves the result unchanged
+    result<std::string> &h = a;
+    a = std::move(h);
+    BOOST_CHECK(a.error() == errc::no_link);
+    a = "niall";
+    a = std::move(h);
+    BOOST_CHECK(a.value() == "niall");
+  }
+#if __cplusplus > 201703L
+  // Test constexpr
+  {
+    constexpr result<int> a(5);
+    static_assert(a.has_value(), "");
+    static_assert(a.assume_value() == 5, "");
+  }
+#endif
+
 #if 0
 #ifdef __cpp_exceptions
   // Test payload facility